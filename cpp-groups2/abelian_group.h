@@ -0,0 +1,408 @@
+#ifndef ALGEBRA_ABELIAN_GROUP_H_
+#define ALGEBRA_ABELIAN_GROUP_H_
+
+#include <cstdint>
+#include <numeric>
+#include <optional>
+#include <ostream>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "modular_nums.h"
+
+// Finite abelian groups from their structure rather than their elements.
+//
+// A subgroup H of A = Z_{m_0} x ... x Z_{m_{k-1}} generated by g_0, ...,
+// g_{r-1} is Z^r / K, where K is the lattice of exponent vectors x with
+// sum_j x_j g_j = 0 in A. K is found one coordinate of A at a time by integer
+// row reduction, and the Smith normal form of a basis of K gives the invariant
+// factors d_0 | d_1 | ... of H. The column operations of that reduction give a
+// basis h_0, h_1, ... of H with h_i of order d_i, so the elements of H are
+// numbered in mixed radix by their coordinates on that basis.
+//
+// The cost is polynomial in k and r and independent of |H|; no element is ever
+// stored. Group::Create on AbusePlusNotation<ModInt<M>> generators does the
+// same job by enumeration.
+
+namespace groups {
+
+class AbelianGroup {
+ public:
+  // Coordinates in A, one per modulus.
+  typedef std::vector<int64_t> Vector;
+
+  // The subgroup of Z_{moduli[0]} x ... x Z_{moduli[k-1]} generated by
+  // generators, each of which has one coordinate per modulus. std::nullopt
+  // is returned if a modulus is not in [1, 2^31), a generator has the wrong
+  // length, or the order of the subgroup doesn't fit in an int64_t (element
+  // indices are int64_t).
+  static std::optional<AbelianGroup> Create(const Vector& moduli,
+                                            const std::vector<Vector>& generators) {
+    for (int64_t m: moduli) {
+      if (m < 1 || m > INT32_MAX) return std::nullopt;
+    }
+    AbelianGroup group;
+    group.moduli_ = moduli;
+    const size_t k = moduli.size();
+    for (const Vector& g: generators) {
+      if (g.size() != k) return std::nullopt;
+      Vector reduced(k);
+      for (size_t c = 0; c < k; c++) reduced[c] = Mod(g[c], moduli[c]);
+      group.generators_.push_back(std::move(reduced));
+    }
+    if (!group.Build()) return std::nullopt;
+    return group;
+  }
+
+  // The cyclic subgroup of Z_Mod generated by the generators.
+  template <int Mod>
+  static AbelianGroup Create(
+      const std::set<AbusePlusNotation<ModInt<Mod>>>& generators) {
+    std::vector<Vector> coordinates;
+    for (const auto& g: generators) coordinates.push_back({g.value().value()});
+    return *Create({Mod}, coordinates);
+  }
+
+  // |H|, the product of the invariant factors.
+  int64_t order() const { return order_; }
+  // The invariant factors d_0 | d_1 | ..., all greater than 1. Empty for the
+  // trivial group.
+  const Vector& invariant_factors() const { return invariant_factors_; }
+  // The largest order of an element, which is the last invariant factor.
+  int64_t exponent() const {
+    return invariant_factors_.empty() ? 1 : invariant_factors_.back();
+  }
+  const Vector& moduli() const { return moduli_; }
+  const std::vector<Vector>& generators() const { return generators_; }
+  // The basis h_i, with h_i of order invariant_factors()[i].
+  const std::vector<Vector>& basis() const { return basis_; }
+
+  // The coordinates of the index-th element on basis(), in mixed radix with
+  // the first coordinate varying fastest.
+  Vector Coordinates(int64_t index) const {
+    Vector z(invariant_factors_.size());
+    for (size_t i = 0; i < z.size(); i++) {
+      z[i] = index % invariant_factors_[i];
+      index /= invariant_factors_[i];
+    }
+    return z;
+  }
+
+  // The inverse of Coordinates. The coordinates may be any integers.
+  int64_t IndexOfCoordinates(const Vector& z) const {
+    int64_t index = 0;
+    for (size_t i = z.size(); i-- > 0;) {
+      index = index * invariant_factors_[i] + Mod(z[i], invariant_factors_[i]);
+    }
+    return index;
+  }
+
+  // The index-th element, as coordinates in A.
+  Vector Element(int64_t index) const {
+    const Vector z = Coordinates(index);
+    Vector a(moduli_.size(), 0);
+    for (size_t i = 0; i < z.size(); i++) {
+      for (size_t c = 0; c < a.size(); c++) {
+        a[c] = Mod(a[c] + static_cast<Wide>(z[i]) * basis_[i][c], moduli_[c]);
+      }
+    }
+    return a;
+  }
+
+  // The index of sum_j x_j g_j, for any exponents x on the generators.
+  int64_t IndexOfWord(const Vector& x) const {
+    Vector z(invariant_factors_.size(), 0);
+    for (size_t i = 0; i < z.size(); i++) {
+      Wide sum = 0;
+      for (size_t j = 0; j < x.size(); j++) {
+        sum = Mod(sum + static_cast<Wide>(x[j]) * to_basis_[j][i],
+                  invariant_factors_[i]);
+      }
+      z[i] = sum;
+    }
+    return IndexOfCoordinates(z);
+  }
+
+  // The index of a, given as coordinates in A, or std::nullopt if a is not
+  // in the group.
+  //
+  // This replays the row reduction of Build: for each coordinate c, the
+  // exponent vectors that vanish on the earlier coordinates reach exactly the
+  // multiples of pivots_[c].value in coordinate c.
+  std::optional<int64_t> IndexOf(const Vector& a) const {
+    if (a.size() != moduli_.size()) return std::nullopt;
+    const size_t r = generators_.size();
+    Vector x(r, 0);
+    for (size_t c = 0; c < moduli_.size(); c++) {
+      const int64_t m = moduli_[c];
+      Wide current = 0;
+      for (size_t j = 0; j < r; j++) {
+        current = Mod(current + static_cast<Wide>(x[j]) * generators_[j][c], m);
+      }
+      const int64_t target = Mod(a[c] - current, m);
+      const Pivot& pivot = pivots_[c];
+      if (target % pivot.value != 0) return std::nullopt;
+      const int64_t times = target / pivot.value;
+      for (size_t j = 0; j < r; j++) {
+        x[j] = Mod(x[j] + static_cast<Wide>(times) * pivot.row[j],
+                   generator_orders_[j]);
+      }
+    }
+    return IndexOfWord(x);
+  }
+
+  bool Contains(const Vector& a) const { return IndexOf(a).has_value(); }
+
+ private:
+  typedef __int128 Wide;
+  typedef std::vector<std::vector<Wide>> Matrix;
+
+  // The exponent vector (over the generators) whose image in coordinate c is
+  // value, the gcd of m_c and everything reachable there.
+  struct Pivot {
+    int64_t value;
+    Vector row;
+  };
+
+  AbelianGroup() = default;
+
+  static int64_t Mod(Wide a, int64_t m) {
+    Wide r = a % m;
+    return static_cast<int64_t>(r < 0 ? r + m : r);
+  }
+
+  // Extended gcd: returns (g, s, t) with s * a + t * b == g >= 0. When a
+  // divides b, t is 0, so that eliminating b leaves a's row or column alone
+  // (otherwise the Smith normal form below can cycle).
+  static void ExtendedGcd(Wide a, Wide b, Wide* g, Wide* s, Wide* t) {
+    if (a != 0 && b % a == 0) {
+      *g = a < 0 ? -a : a;
+      *s = a < 0 ? -1 : 1;
+      *t = 0;
+      return;
+    }
+    Wide r0 = a, r1 = b, s0 = 1, s1 = 0, t0 = 0, t1 = 1;
+    while (r1 != 0) {
+      Wide q = r0 / r1;
+      std::swap(r0, r1);
+      r1 -= q * r0;
+      std::swap(s0, s1);
+      s1 -= q * s0;
+      std::swap(t0, t1);
+      t1 -= q * t0;
+    }
+    if (r0 < 0) {
+      r0 = -r0;
+      s0 = -s0;
+      t0 = -t0;
+    }
+    *g = r0;
+    *s = s0;
+    *t = t0;
+  }
+
+  // Replaces rows p and q by a unimodular combination so that
+  // rows[p][col] becomes gcd(rows[p][col], rows[q][col]) and rows[q][col]
+  // becomes 0.
+  static void CombineRows(std::vector<Wide>* p, std::vector<Wide>* q,
+                          size_t col) {
+    const Wide a = (*p)[col], b = (*q)[col];
+    if (b == 0) return;
+    Wide g, s, t;
+    ExtendedGcd(a, b, &g, &s, &t);
+    for (size_t i = 0; i < p->size(); i++) {
+      const Wide x = (*p)[i], y = (*q)[i];
+      (*p)[i] = s * x + t * y;
+      (*q)[i] = (a / g) * y - (b / g) * x;
+    }
+  }
+
+  // Reduces rows to an upper triangular basis of the lattice they span
+  // (which must have full rank), keeping entries below the diagonal.
+  static Matrix Hermite(Matrix rows) {
+    const size_t r = rows.empty() ? 0 : rows[0].size();
+    for (size_t col = 0; col < r; col++) {
+      for (size_t i = col + 1; i < rows.size(); i++) {
+        CombineRows(&rows[col], &rows[i], col);
+      }
+      if (rows[col][col] < 0) {
+        for (Wide& v: rows[col]) v = -v;
+      }
+      const Wide d = rows[col][col];
+      for (size_t i = 0; i < col; i++) {
+        Wide q = rows[i][col] / d;
+        if (rows[i][col] - q * d < 0) q--;
+        for (size_t j = col; j < r; j++) rows[i][j] -= q * rows[col][j];
+      }
+    }
+    rows.resize(r);
+    return rows;
+  }
+
+  // False if |H| doesn't fit in an int64_t.
+  bool Build() {
+    const size_t r = generators_.size();
+    for (const Vector& g: generators_) {
+      // The order of g divides |H|, so it fits whenever |H| does.
+      int64_t order = 1;
+      for (size_t c = 0; c < moduli_.size(); c++) {
+        const int64_t m = moduli_[c];
+        const int64_t o = m / std::gcd(g[c], m);
+        if (__builtin_mul_overflow(order / std::gcd(order, o), o, &order)) {
+          return false;
+        }
+      }
+      generator_orders_.push_back(order);
+    }
+
+    // K starts as all of Z^r, and each coordinate c of A cuts it down to the
+    // vectors whose image there is 0 mod m_c. The multiples of each generator's
+    // order are in K throughout, which keeps the basis square and its entries
+    // below the generator orders.
+    Matrix kernel(r, std::vector<Wide>(r, 0));
+    for (size_t j = 0; j < r; j++) kernel[j][j] = 1;
+    for (size_t c = 0; c < moduli_.size(); c++) {
+      const int64_t m = moduli_[c];
+      // Each row is (image in coordinate c, exponent vector), plus the row
+      // (m, 0) since the image is only defined mod m.
+      Matrix rows;
+      for (const auto& b: kernel) {
+        std::vector<Wide> row{0};
+        for (size_t j = 0; j < r; j++) {
+          row[0] = Mod(row[0] + b[j] * generators_[j][c], m);
+          row.push_back(b[j]);
+        }
+        rows.push_back(std::move(row));
+      }
+      rows.push_back(std::vector<Wide>(r + 1, 0));
+      rows.back()[0] = m;
+      for (size_t i = 0; i + 1 < rows.size(); i++) {
+        CombineRows(&rows.back(), &rows[i], 0);
+      }
+      Pivot pivot{static_cast<int64_t>(rows.back()[0]), Vector(r)};
+      for (size_t j = 0; j < r; j++) {
+        pivot.row[j] = Mod(rows.back()[j + 1], generator_orders_[j]);
+      }
+      pivots_.push_back(std::move(pivot));
+      rows.pop_back();
+
+      Matrix next;
+      for (auto& row: rows) next.emplace_back(row.begin() + 1, row.end());
+      for (size_t j = 0; j < r; j++) {
+        next.push_back(std::vector<Wide>(r, 0));
+        next.back()[j] = generator_orders_[j];
+      }
+      kernel = Hermite(std::move(next));
+    }
+    return SmithNormalForm(&kernel);
+  }
+
+  // Diagonalizes the basis of K with row operations (which don't change the
+  // lattice) and column operations (which change coordinates on Z^r). The
+  // column operations are kept as V, and their inverse as V^-1: x -> x V
+  // takes exponent vectors to coordinates on the new basis, whose elements
+  // are the rows of V^-1 applied to the generators. False if |H| doesn't
+  // fit in an int64_t.
+  bool SmithNormalForm(Matrix* a) {
+    Matrix& k = *a;
+    const size_t r = k.size();
+    Matrix v(r, std::vector<Wide>(r, 0)), v_inv = v;
+    for (size_t i = 0; i < r; i++) v[i][i] = v_inv[i][i] = 1;
+
+    for (size_t t = 0; t < r; t++) {
+      while (true) {
+        for (size_t i = t + 1; i < r; i++) CombineRows(&k[t], &k[i], t);
+        bool column_done = true;
+        for (size_t j = t + 1; j < r; j++) {
+          if (k[t][j] == 0) continue;
+          column_done = false;
+          // Columns t and j, by the 2x2 E = [[s, -b/g], [u, a/g]].
+          const Wide x = k[t][t], y = k[t][j];
+          Wide g, s, u;
+          ExtendedGcd(x, y, &g, &s, &u);
+          const Wide p = x / g, q = y / g;
+          for (size_t i = 0; i < r; i++) {
+            const Wide kt = k[i][t], kj = k[i][j];
+            k[i][t] = s * kt + u * kj;
+            k[i][j] = p * kj - q * kt;
+            const Wide vt = v[i][t], vj = v[i][j];
+            v[i][t] = s * vt + u * vj;
+            v[i][j] = p * vj - q * vt;
+            // E^-1 = [[a/g, b/g], [-u, s]] acts on the rows of V^-1.
+            const Wide wt = v_inv[t][i], wj = v_inv[j][i];
+            v_inv[t][i] = p * wt + q * wj;
+            v_inv[j][i] = s * wj - u * wt;
+          }
+        }
+        if (!column_done) continue;
+        bool rows_clear = true;
+        for (size_t i = t + 1; i < r; i++) rows_clear = rows_clear && k[i][t] == 0;
+        if (!rows_clear) continue;
+        // The pivot must divide the rest of the matrix; if some entry isn't
+        // a multiple, adding its row to row t brings it into the pivot.
+        bool divides = true;
+        for (size_t i = t + 1; i < r && divides; i++) {
+          for (size_t j = t + 1; j < r; j++) {
+            if (k[i][j] % k[t][t] != 0) {
+              for (size_t l = 0; l < r; l++) k[t][l] += k[i][l];
+              divides = false;
+              break;
+            }
+          }
+        }
+        if (divides) break;
+      }
+      if (k[t][t] < 0) {
+        for (Wide& e: k[t]) e = -e;
+      }
+    }
+
+    order_ = 1;
+    to_basis_.assign(r, {});
+    for (size_t t = 0; t < r; t++) {
+      if (k[t][t] > INT64_MAX) return false;
+      const int64_t d = static_cast<int64_t>(k[t][t]);
+      if (d == 1) continue;
+      if (__builtin_mul_overflow(order_, d, &order_)) return false;
+      invariant_factors_.push_back(d);
+      Vector h(moduli_.size(), 0);
+      for (size_t j = 0; j < r; j++) {
+        for (size_t c = 0; c < moduli_.size(); c++) {
+          h[c] = Mod(h[c] + Mod(v_inv[t][j], moduli_[c]) *
+                                static_cast<Wide>(generators_[j][c]),
+                     moduli_[c]);
+        }
+      }
+      basis_.push_back(std::move(h));
+      for (size_t j = 0; j < r; j++) to_basis_[j].push_back(Mod(v[j][t], d));
+    }
+    return true;
+  }
+
+  Vector moduli_;
+  std::vector<Vector> generators_;
+  Vector generator_orders_;
+  std::vector<Pivot> pivots_;
+  int64_t order_ = 1;
+  Vector invariant_factors_;
+  std::vector<Vector> basis_;
+  // to_basis_[j][i] is the i-th basis coordinate of generator j.
+  std::vector<Vector> to_basis_;
+};
+
+// Prints the structure, e.g. "Z_2 x Z_12".
+inline std::ostream& operator<<(std::ostream& o, const AbelianGroup& g) {
+  if (g.invariant_factors().empty()) return o << "Z_1";
+  bool first = true;
+  for (int64_t d: g.invariant_factors()) {
+    if (!first) o << " x ";
+    o << "Z_" << d;
+    first = false;
+  }
+  return o;
+}
+
+} // namespace groups
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef ALGEBRA_ASSOCIATIVITY_H_
+#define ALGEBRA_ASSOCIATIVITY_H_
+
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "group.h"
+#include "thread_pool.h"
+
+// Checking that a user-defined GroupElement really is associative.
+//
+// Group::Create only checks identities and inverses, and its closure assumes
+// associativity. All of these use Light's test: the set of a for which
+// (x * a) * y == x * (a * y) for all x, y is closed under *, so it's enough to
+// check the triples whose middle element is a generator. That's |G|^2 per
+// generator instead of |G|^3 overall. Beyond that:
+// - the exhaustive check can be split over a thread pool, and
+// - a sampling mode checks random Light triples, enough of them to catch a
+//   given fraction of failing triples with a given confidence.
+
+namespace groups {
+
+struct AssociativityOptions {
+  // Worker threads for the exhaustive check; 0 means one per hardware thread.
+  size_t threads = 0;
+  // When set, sample instead of checking every Light triple, with this
+  // probability of catching non-associativity (below 1, or every triple is
+  // checked)...
+  std::optional<double> confidence;
+  // ...provided at least this fraction of the Light triples fail (above 0, or
+  // every triple is checked).
+  double failure_fraction = 0.01;
+  uint64_t seed = 0;
+};
+
+template <GroupElement E>
+struct AssociativityResult {
+  bool associative;
+  // A triple (a, b, c) with (a * b) * c != a * (b * c), if one was found.
+  std::optional<std::array<E, 3>> counterexample;
+  uint64_t triples_checked;
+};
+
+// The number of random triples needed to see a failure with probability
+// confidence when a fraction failure_fraction of triples fail:
+// 1 - (1 - failure_fraction)^n >= confidence. std::nullopt if no number of
+// samples is enough, which is when confidence >= 1 or failure_fraction <= 0
+// (or either is NaN), or when the count doesn't fit in a uint64_t.
+inline std::optional<uint64_t> AssociativitySamples(double confidence,
+                                                    double failure_fraction) {
+  if (confidence <= 0) return 0;
+  if (failure_fraction >= 1) return 1;
+  if (!(confidence < 1) || !(failure_fraction > 0)) return std::nullopt;
+  const double samples =
+      std::ceil(std::log1p(-confidence) / std::log1p(-failure_fraction));
+  if (!(samples < 0x1p64)) return std::nullopt;
+  return static_cast<uint64_t>(samples);
+}
+
+template <GroupElement E, ElementStorage<E> Storage>
+AssociativityResult<E> VerifyAssociativity(
+    const Group<E, Storage>& group, const AssociativityOptions& options = {}) {
+  const std::vector<E> elements(group.elements().begin(),
+                                group.elements().end());
+  const std::vector<E> generators(group.generators().begin(),
+                                  group.generators().end());
+  AssociativityResult<E> result{true, std::nullopt, 0};
+  if (elements.empty() || generators.empty()) return result;
+
+  // When sampling can't reach the confidence asked for, every triple is
+  // checked instead.
+  const std::optional<uint64_t> samples =
+      options.confidence.has_value()
+          ? AssociativitySamples(*options.confidence, options.failure_fraction)
+          : std::nullopt;
+  if (samples.has_value()) {
+    std::mt19937_64 rng(options.seed);
+    std::uniform_int_distribution<size_t> pick_element(0, elements.size() - 1);
+    std::uniform_int_distribution<size_t> pick_generator(
+        0, generators.size() - 1);
+    for (; result.triples_checked < *samples; result.triples_checked++) {
+      const E& x = elements[pick_element(rng)];
+      const E& g = generators[pick_generator(rng)];
+      const E& y = elements[pick_element(rng)];
+      if ((x * g) * y != x * (g * y)) {
+        result.triples_checked++;
+        result.associative = false;
+        result.counterexample = std::array<E, 3>{x, g, y};
+        return result;
+      }
+    }
+    return result;
+  }
+
+  ThreadPool pool(options.threads);
+  std::atomic<bool> failed = false;
+  std::atomic<uint64_t> checked = 0;
+  std::mutex counterexample_mutex;
+  for (const E& g: generators) {
+    // g * y is shared by every x.
+    std::vector<E> gy;
+    gy.reserve(elements.size());
+    for (const E& y: elements) gy.push_back(g * y);
+    pool.ParallelFor(elements.size(), 16, [&](size_t begin, size_t end,
+                                              size_t) {
+      uint64_t local_checked = 0;
+      for (size_t i = begin; i < end && !failed; i++) {
+        const E& x = elements[i];
+        const E xg = x * g;
+        for (size_t j = 0; j < elements.size(); j++) {
+          local_checked++;
+          if (xg * elements[j] == x * gy[j]) continue;
+          std::lock_guard<std::mutex> lock(counterexample_mutex);
+          if (!failed) {
+            failed = true;
+            result.counterexample = std::array<E, 3>{x, g, elements[j]};
+          }
+          break;
+        }
+      }
+      checked += local_checked;
+    });
+    if (failed) break;
+  }
+  result.associative = !failed;
+  result.triples_checked = checked;
+  return result;
+}
+
+} // namespace groups
+
+#endif
@@ -0,0 +1,544 @@
+// Benchmarks for group construction and the operations it leans on.
+//
+// Each case runs in a forked child so that its peak RSS is its own. Wall time
+// and memory are measured on the plain element types. Products are counted by
+// running the same work again on CountingElement<E> (see counting.h) in a
+// child of its own, so the counters don't add to the timings.
+//
+// Usage:
+//   benchmark [--filter SUBSTRING] [--json OUT] [--compare BASELINE]
+//             [--threshold FRACTION]
+// --json writes the results as JSON, one case per line. --compare reads a file
+// written by --json and flags every case whose wall time grew by more than the
+// threshold (default 0.25), and by more than half a millisecond, exiting with
+// status 1 if any did.
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "counting.h"
+#include "element_stream.h"
+#include "coset_enumeration.h"
+#include "element_storage.h"
+#include "group.h"
+#include "group_cache.h"
+#include "isomorphism.h"
+#include "modular_nums.h"
+#include "permutations.h"
+#include "product.h"
+
+namespace {
+
+using groups::CountingElement;
+
+// Somewhere for results to go so that the work isn't optimized out.
+volatile int sink;
+
+struct Result {
+  std::string name;
+  uint64_t elements = 0;
+  uint64_t products = 0;
+  double wall_ms = 0;
+  long peak_rss_kb = 0;
+
+  double ProductsPerSecond() const { return products / (wall_ms / 1000); }
+  double ElementsPerSecond() const { return elements / (wall_ms / 1000); }
+};
+
+struct Work {
+  // Runs the work and returns the number of elements it produced (0 for
+  // work that doesn't build a group).
+  std::function<uint64_t()> run;
+  // If set, runs first and isn't timed. Its memory still counts to the peak.
+  std::function<void()> setup = nullptr;
+};
+
+struct Case {
+  std::string name;
+  // Timed, on the plain element types.
+  Work timed;
+  // The same work on CountingElement types, for the product count. Cases with
+  // no products to count leave it empty.
+  std::optional<Work> counted = std::nullopt;
+};
+
+// E for the timed run, CountingElement<E> for the counted one.
+template <typename E, bool kCounted>
+using Element = std::conditional_t<kCounted, CountingElement<E>, E>;
+
+template <bool kCounted, groups::GroupElement E>
+std::set<Element<E, kCounted>> Elements(const std::set<E>& elements) {
+  return std::set<Element<E, kCounted>>(elements.begin(), elements.end());
+}
+
+// Closure of the generators, as Group::Create.
+template <bool kCounted, groups::GroupElement E>
+Work CreateWork(std::set<E> generators) {
+  return {[generators]() -> uint64_t {
+    auto g = groups::Group<Element<E, kCounted>>::Create(
+        Elements<kCounted>(generators));
+    return g.has_value() ? g->elements().size() : 0;
+  }};
+}
+
+template <groups::GroupElement E>
+Case CreateCase(std::string name, std::set<E> generators) {
+  return {name, CreateWork<false>(generators), CreateWork<true>(generators)};
+}
+
+// Light's associativity test. The closure that builds the group is part of
+// the timing and the product count.
+template <bool kCounted, groups::GroupElement E>
+Work AssociativityWork(std::set<E> generators) {
+  return {[generators]() -> uint64_t {
+    auto g = groups::Group<Element<E, kCounted>>::Create(
+        Elements<kCounted>(generators));
+    if (!g.has_value() || !g->TestAssociativity()) return 0;
+    return g->elements().size();
+  }};
+}
+
+template <groups::GroupElement E>
+Case AssociativityCase(std::string name, std::set<E> generators) {
+  return {name, AssociativityWork<false>(generators),
+          AssociativityWork<true>(generators)};
+}
+
+// Raw Permutation<N>::operator* throughput, multiplying through a fixed list
+// of permutations (spread out over S_N by rank) rounds times.
+template <bool kCounted, size_t N>
+Work MultiplyWork(uint64_t count, uint64_t rounds) {
+  return {[count, rounds]() -> uint64_t {
+    typedef Element<groups::Permutation<N>, kCounted> P;
+    std::vector<P> elements;
+    uint64_t factorial = 1;
+    for (size_t i = 2; i <= N; i++) factorial *= i;
+    for (uint64_t i = 0; i < count; i++) {
+      elements.push_back(groups::Permutation<N>::Unrank(
+          (i * 0x9e3779b97f4a7c15ull) % factorial));
+    }
+    P acc = elements[0];
+    groups::OperationCounts::Reset();
+    for (uint64_t r = 0; r < rounds; r++) {
+      for (const P& e: elements) acc = acc * e;
+    }
+    if constexpr (kCounted) {
+      sink = acc.value().Image(0);
+    } else {
+      sink = acc.Image(0);
+    }
+    return 0;
+  }};
+}
+
+template <size_t N>
+Case MultiplyCase(std::string name, uint64_t count, uint64_t rounds) {
+  return {name, MultiplyWork<false, N>(count, rounds),
+          MultiplyWork<true, N>(count, rounds)};
+}
+
+// Adjacent transpositions (i i+1), the Coxeter generators of S_N.
+template <size_t N>
+std::set<groups::Permutation<N>> Transpositions() {
+  std::set<groups::Permutation<N>> generators;
+  for (size_t i = 0; i + 1 < N; i++) {
+    std::array<int, N> dests;
+    for (size_t j = 0; j < N; j++) dests[j] = j;
+    std::swap(dests[i], dests[i + 1]);
+    generators.insert(*groups::Permutation<N>::Create(dests));
+  }
+  return generators;
+}
+
+template <size_t N>
+void AddSymmetric(std::vector<Case>* cases) {
+  const std::string n = std::to_string(N);
+  cases->push_back(CreateCase("create/S" + n + "/cycle+swap",
+                              groups::Permutation<N>::GetGroupGenerators()));
+  if constexpr (N <= 8) {
+    cases->push_back(
+        CreateCase("create/S" + n + "/transpositions", Transpositions<N>()));
+  }
+  if constexpr (N <= 6) {
+    cases->push_back(AssociativityCase(
+        "associativity/S" + n, groups::Permutation<N>::GetGroupGenerators()));
+  }
+}
+
+template <int M>
+using Cyclic = groups::AbusePlusNotation<groups::ModInt<M>>;
+
+// Building S_9 and Z_100000 on a storage backend, and then iterating over S_9
+// (which isn't timed with the build).
+template <template <typename...> class Storage>
+void AddStorage(const std::string& storage, std::vector<Case>* cases) {
+  typedef groups::Permutation<9> P;
+  cases->push_back({"storage/" + storage + "/create/S9", {[]() -> uint64_t {
+    return groups::Group<P, Storage<P>>::Create(P::GetGroupGenerators())
+        ->elements().size();
+  }}});
+  typedef Cyclic<100000> Z100000;
+  cases->push_back({"storage/" + storage + "/create/Z100000",
+                    {[]() -> uint64_t {
+    const std::set<Z100000> generators{Z100000(6), Z100000(25)};
+    return groups::Group<Z100000, Storage<Z100000>>::Create(generators)
+        ->elements().size();
+  }}});
+
+  auto group = std::make_shared<std::optional<groups::Group<P, Storage<P>>>>();
+  Case iterate{"storage/" + storage + "/iterate/S9", {[group]() -> uint64_t {
+    int total = 0;
+    for (int pass = 0; pass < 20; pass++) {
+      for (const P& p: (*group)->elements()) total += p.Image(pass % 9);
+    }
+    sink = total;
+    return (*group)->elements().size() * 20;
+  }}};
+  iterate.timed.setup = [group]() {
+    *group = groups::Group<P, Storage<P>>::Create(P::GetGroupGenerators());
+  };
+  cases->push_back(iterate);
+}
+
+// Loading S_9 from a GroupCache file saved by the (untimed) setup, and
+// reading every element once, to compare with building it.
+Case CacheLoadCase() {
+  typedef groups::Permutation<9> P;
+  auto directory = std::make_shared<std::string>();
+  Case load{"cache/load/S9", {[directory]() -> uint64_t {
+    auto group = groups::GroupCache(*directory).Find(P::GetGroupGenerators());
+    // The mapping outlives the file.
+    std::filesystem::remove_all(*directory);
+    int total = 0;
+    for (const P& p: group->elements()) total += p.Image(0);
+    sink = total;
+    return group->size();
+  }}};
+  load.timed.setup = [directory]() {
+    char path[] = "/tmp/group_cache_XXXXXX";
+    *directory = mkdtemp(path);
+    groups::GroupCache(*directory).FindOrCreate(P::GetGroupGenerators());
+  };
+  return load;
+}
+
+// Todd-Coxeter on the Coxeter presentation of S_n, over the trivial subgroup.
+// With max_bytes set, a cap small enough that the table is compacted during
+// the enumeration.
+Case CosetCase(int n, groups::CosetStrategy strategy,
+               std::optional<size_t> max_bytes = std::nullopt) {
+  groups::Presentation presentation;
+  presentation.generators = n - 1;
+  for (int i = 1; i < n; i++) {
+    presentation.relators.push_back({i, i});
+    for (int j = i + 1; j < n; j++) {
+      if (j == i + 1) {
+        presentation.relators.push_back({i, j, i, j, i, j});
+      } else {
+        presentation.relators.push_back({i, j, i, j});
+      }
+    }
+  }
+  std::string name = strategy == groups::CosetStrategy::kHlt ? "hlt"
+                                                             : "felsch";
+  if (max_bytes.has_value()) name += "/compacting";
+  return {"coset_enumeration/S" + std::to_string(n) + "/" + name,
+          {[presentation, strategy, max_bytes]() -> uint64_t {
+    groups::CosetEnumerationOptions options;
+    options.strategy = strategy;
+    if (max_bytes.has_value()) options.max_bytes = *max_bytes;
+    auto table = groups::CosetTable::Enumerate(presentation, options);
+    return table.has_value() ? table->index() : 0;
+  }}};
+}
+
+// Finding an isomorphism between S_7 from (0 1 ... 6) and (0 1) and S_7 from
+// its adjacent transpositions, both already built.
+Case IsomorphismCase() {
+  typedef groups::Permutation<7> P;
+  auto groups = std::make_shared<std::vector<groups::Group<P>>>();
+  Case find{"isomorphism/S7", {[groups]() -> uint64_t {
+    auto phi = groups::FindIsomorphism((*groups)[0], (*groups)[1]);
+    return phi.has_value() ? phi->domain().size() : 0;
+  }}};
+  find.timed.setup = [groups]() {
+    groups->push_back(*groups::Group<P>::Create(P::GetGroupGenerators()));
+    groups->push_back(*groups::Group<P>::Create(Transpositions<7>()));
+  };
+  return find;
+}
+
+// Writing out S_10 from its stabilizer chain, as text, without building the
+// group.
+Case StreamCase() {
+  return {"stream/S10/text", {[]() -> uint64_t {
+    typedef groups::Permutation<10> P;
+    const groups::StabilizerChain<10> chain(P::GetGroupGenerators());
+    std::ofstream out("/dev/null");
+    return groups::WriteElements(out, groups::ChainElements<10>(chain));
+  }}};
+}
+
+// Extending S_8 (as the stabilizer of 8 in S_9, already built) to S_9 with
+// a 9-cycle, against building S_9 from the same generators.
+template <bool kCounted>
+Work AddGeneratorWork(const std::set<groups::Permutation<9>>& s8,
+                      const groups::Permutation<9>& nine_cycle) {
+  typedef Element<groups::Permutation<9>, kCounted> P;
+  auto group = std::make_shared<std::optional<groups::Group<P>>>();
+  Work add{[group, nine_cycle]() -> uint64_t {
+    auto g = groups::Group<P>::AddGenerator(std::move(**group), nine_cycle);
+    return g.has_value() ? g->elements().size() : 0;
+  }};
+  add.setup = [group, s8]() {
+    *group = groups::Group<P>::Create(Elements<kCounted>(s8));
+  };
+  return add;
+}
+
+void AddIncremental(std::vector<Case>* cases) {
+  typedef groups::Permutation<9> P;
+  std::set<P> s8;
+  for (const auto& g: groups::Permutation<8>::GetGroupGenerators()) {
+    std::array<int, 9> dests;
+    for (size_t i = 0; i < 8; i++) dests[i] = g.Image(i);
+    dests[8] = 8;
+    s8.insert(*P::Create(dests));
+  }
+  std::array<int, 9> cycle;
+  for (size_t i = 0; i < 9; i++) cycle[i] = (i + 1) % 9;
+  const P nine_cycle = *P::Create(cycle);
+
+  cases->push_back({"add_generator/S8+9cycle",
+                    AddGeneratorWork<false>(s8, nine_cycle),
+                    AddGeneratorWork<true>(s8, nine_cycle)});
+  std::set<P> all = s8;
+  all.insert(nine_cycle);
+  cases->push_back(CreateCase("add_generator/from_scratch", all));
+}
+
+template <int M>
+Cyclic<M> Z(int n) {
+  return Cyclic<M>(groups::ModInt<M>(n));
+}
+
+template <bool kCounted>
+Work DirectProductWork() {
+  return {[]() -> uint64_t {
+    typedef groups::Permutation<5> P;
+    auto s5 = *groups::Group<Element<P, kCounted>>::Create(
+        Elements<kCounted>(P::GetGroupGenerators()));
+    auto z6 = *groups::Group<Element<Cyclic<6>, kCounted>>::Create(
+        Elements<kCounted>(std::set{Z<6>(1)}));
+    auto z2 = *groups::Group<Element<Cyclic<2>, kCounted>>::Create(
+        Elements<kCounted>(std::set{Z<2>(1)}));
+    return groups::DirectProduct(s5, z6, z2).elements().size();
+  }};
+}
+
+std::vector<Case> AllCases() {
+  std::vector<Case> cases;
+  AddSymmetric<3>(&cases);
+  AddSymmetric<4>(&cases);
+  AddSymmetric<5>(&cases);
+  AddSymmetric<6>(&cases);
+  AddSymmetric<7>(&cases);
+  AddSymmetric<8>(&cases);
+  AddSymmetric<9>(&cases);
+
+  cases.push_back(MultiplyCase<8>("multiply/Permutation8", 4096, 2000));
+  cases.push_back(MultiplyCase<16>("multiply/Permutation16", 4096, 2000));
+
+  cases.push_back(CreateCase("create/Z1000",
+                             std::set{Z<1000>(1)}));
+  cases.push_back(CreateCase("create/Z100000", std::set{Z<100000>(1)}));
+  cases.push_back(CreateCase("create/Z100000/two_generators",
+                             std::set{Z<100000>(6), Z<100000>(25)}));
+  cases.push_back(CreateCase(
+      "create/units_mod_65537",
+      std::set{groups::Units<groups::ModInt<65537>>(groups::ModInt<65537>(3))}));
+
+  using P = groups::Product<Cyclic<6>, Cyclic<10>, Cyclic<15>, Cyclic<7>>;
+  cases.push_back(CreateCase(
+      "create/Z6xZ10xZ15xZ7",
+      std::set{P(Z<6>(1), Z<10>(0), Z<15>(0), Z<7>(0)),
+               P(Z<6>(0), Z<10>(1), Z<15>(0), Z<7>(0)),
+               P(Z<6>(0), Z<10>(0), Z<15>(1), Z<7>(0)),
+               P(Z<6>(0), Z<10>(0), Z<15>(0), Z<7>(1))}));
+  cases.push_back({"direct_product/S5xZ6xZ2", DirectProductWork<false>(),
+                   DirectProductWork<true>()});
+
+  AddStorage<std::set>("set", &cases);
+  AddStorage<groups::FlatSet>("flat", &cases);
+  AddStorage<groups::ArenaSet>("arena", &cases);
+  cases.push_back(CacheLoadCase());
+  cases.push_back(CosetCase(8, groups::CosetStrategy::kHlt));
+  cases.push_back(CosetCase(8, groups::CosetStrategy::kFelsch));
+  // HLT peaks at 41051 cosets of 60 bytes, so 3 MiB compacts a few times.
+  cases.push_back(CosetCase(8, groups::CosetStrategy::kHlt, 3 << 20));
+  cases.push_back(IsomorphismCase());
+  cases.push_back(StreamCase());
+  AddIncremental(&cases);
+  return cases;
+}
+
+// Runs the work in a child process and reads its result back over a pipe.
+std::optional<Result> RunWork(const Work& work) {
+  int fds[2];
+  if (pipe(fds) != 0) return std::nullopt;
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    if (work.setup) work.setup();
+    groups::OperationCounts::Reset();
+    const auto start = std::chrono::steady_clock::now();
+    const uint64_t elements = work.run();
+    const auto end = std::chrono::steady_clock::now();
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    const double ms =
+        std::chrono::duration<double, std::milli>(end - start).count();
+    const std::string line = std::to_string(elements) + " " +
+                             std::to_string(
+                                 groups::OperationCounts::Current().products) +
+                             " " +
+                             std::to_string(ms) + " " +
+                             std::to_string(usage.ru_maxrss) + "\n";
+    write(fds[1], line.data(), line.size());
+    _exit(0);
+  }
+  close(fds[1]);
+  std::string out;
+  char buffer[256];
+  for (ssize_t n; (n = read(fds[0], buffer, sizeof(buffer))) > 0;) {
+    out.append(buffer, n);
+  }
+  close(fds[0]);
+  int status;
+  waitpid(pid, &status, 0);
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) return std::nullopt;
+  Result r;
+  std::istringstream(out) >> r.elements >> r.products >> r.wall_ms >>
+      r.peak_rss_kb;
+  return r;
+}
+
+// The timed run for the time, elements and memory, and then the counted run
+// for the products.
+std::optional<Result> Run(const Case& c) {
+  std::optional<Result> r = RunWork(c.timed);
+  if (!r.has_value()) return std::nullopt;
+  r->name = c.name;
+  if (c.counted.has_value()) {
+    std::optional<Result> counted = RunWork(*c.counted);
+    if (!counted.has_value() || counted->elements != r->elements) {
+      return std::nullopt;
+    }
+    r->products = counted->products;
+  }
+  return r;
+}
+
+std::string ToJson(const Result& r) {
+  std::ostringstream o;
+  o << "{\"name\": \"" << r.name << "\", \"elements\": " << r.elements
+    << ", \"products\": " << r.products << ", \"wall_ms\": " << r.wall_ms
+    << ", \"products_per_sec\": " << static_cast<uint64_t>(r.ProductsPerSecond())
+    << ", \"elements_per_sec\": " << static_cast<uint64_t>(r.ElementsPerSecond())
+    << ", \"peak_rss_kb\": " << r.peak_rss_kb << "}";
+  return o.str();
+}
+
+// Reads name -> wall_ms from a file written by --json. Each case is on its own
+// line, so this only needs to find the two fields in each line.
+std::map<std::string, double> ReadBaseline(const std::string& path) {
+  std::map<std::string, double> baseline;
+  std::ifstream in(path);
+  for (std::string line; std::getline(in, line);) {
+    const size_t name = line.find("\"name\": \"");
+    const size_t wall = line.find("\"wall_ms\": ");
+    if (name == std::string::npos || wall == std::string::npos) continue;
+    const size_t start = name + 9;
+    baseline[line.substr(start, line.find('"', start) - start)] =
+        std::stod(line.substr(wall + 11));
+  }
+  return baseline;
+}
+
+// Wall time differences below this are not regressions.
+constexpr double kNoiseMs = 0.5;
+
+} // namespace
+
+int main(int argc, char** argv) {
+  std::string filter, json_path, baseline_path;
+  double threshold = 0.25;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const std::string flag = argv[i];
+    if (flag == "--filter") filter = argv[i + 1];
+    else if (flag == "--json") json_path = argv[i + 1];
+    else if (flag == "--compare") baseline_path = argv[i + 1];
+    else if (flag == "--threshold") threshold = std::stod(argv[i + 1]);
+    else {
+      std::cerr << "Unknown flag " << flag << std::endl;
+      return 2;
+    }
+  }
+  std::map<std::string, double> baseline;
+  if (!baseline_path.empty()) baseline = ReadBaseline(baseline_path);
+
+  std::vector<Result> results;
+  bool regressed = false;
+  std::printf("%-34s %10s %12s %10s %14s %14s %10s\n", "case", "elements",
+              "products", "wall ms", "products/s", "elements/s", "peak KiB");
+  for (const Case& c: AllCases()) {
+    if (c.name.find(filter) == std::string::npos) continue;
+    std::optional<Result> r = Run(c);
+    if (!r.has_value()) {
+      std::printf("%-34s failed\n", c.name.c_str());
+      regressed = true;
+      continue;
+    }
+    std::printf("%-34s %10lu %12lu %10.2f %14.0f %14.0f %10ld", c.name.c_str(),
+                r->elements, r->products, r->wall_ms, r->ProductsPerSecond(),
+                r->ElementsPerSecond(), r->peak_rss_kb);
+    auto it = baseline.find(c.name);
+    // Sub-millisecond cases are mostly noise, so small absolute changes are
+    // never flagged.
+    if (it != baseline.end() && r->wall_ms > it->second * (1 + threshold) &&
+        r->wall_ms - it->second > kNoiseMs) {
+      std::printf("  REGRESSION (baseline %.2f ms)", it->second);
+      regressed = true;
+    }
+    std::printf("\n");
+    results.push_back(*r);
+  }
+
+  if (!json_path.empty()) {
+    std::ofstream out(json_path);
+    out << "{\"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+      out << "  " << ToJson(results[i]) << (i + 1 < results.size() ? "," : "")
+          << "\n";
+    }
+    out << "]}\n";
+  }
+  return regressed ? 1 : 0;
+}
@@ -0,0 +1,129 @@
+#ifndef ALGEBRA_CAYLEY_TABLE_H_
+#define ALGEBRA_CAYLEY_TABLE_H_
+
+#include <algorithm>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
+
+#include "group.h"
+
+// Dense multiplication tables for finite groups.
+//
+// Once a Group is built, its elements can be numbered 0, ..., |G| - 1 (in the
+// order of the group's std::set) and every product and inverse precomputed.
+// Algorithms that multiply the same elements over and over can then work on
+// indices in flat arrays without calling E::operator* or searching the set.
+// The table takes |G|^2 indices of memory, so this is for groups of up to a
+// few thousand elements; use uint16_t indices when |G| fits to halve that.
+
+namespace groups {
+
+template <GroupElement E, std::unsigned_integral Index = uint32_t>
+class CayleyTable {
+ public:
+  // Builds the table for the group. std::nullopt is returned when the group
+  // has too many elements to be numbered by Index.
+  //
+  // Only |G| * |generators| products of elements are computed. The rest of
+  // the table comes from index lookups: if b = c * g for a generator g, then
+  // a * b = (a * c) * g, which is a lookup in the column of g. That step
+  // assumes E is associative, so the table can't be used to check it; see
+  // associativity.h for that.
+  template <ElementStorage<E> Storage>
+  static std::optional<CayleyTable> Create(const Group<E, Storage>& group) {
+    const size_t n = group.elements().size();
+    if (n - 1 > std::numeric_limits<Index>::max()) return std::nullopt;
+    CayleyTable table;
+    table.elements_.assign(group.elements().begin(), group.elements().end());
+    table.identity_ = *table.IndexOf(group.identity());
+    for (const E& g: group.generators()) {
+      table.generators_.push_back(*table.IndexOf(g));
+    }
+
+    // Right multiplication by each generator.
+    const size_t num_gens = table.generators_.size();
+    std::vector<Index> gen_columns(num_gens * n);
+    for (size_t k = 0; k < num_gens; k++) {
+      const E& g = table.elements_[table.generators_[k]];
+      for (size_t a = 0; a < n; a++) {
+        gen_columns[k * n + a] = *table.IndexOf(table.elements_[a] * g);
+      }
+    }
+
+    // A breadth-first spanning tree from the identity, so that each element
+    // comes after the element it is reached from.
+    std::vector<Index> order{table.identity_};
+    std::vector<Index> parent(n, table.identity_);
+    std::vector<Index> via(n, 0);
+    std::vector<bool> seen(n, false);
+    seen[table.identity_] = true;
+    for (size_t i = 0; i < order.size(); i++) {
+      for (size_t k = 0; k < num_gens; k++) {
+        Index next = gen_columns[k * n + order[i]];
+        if (seen[next]) continue;
+        seen[next] = true;
+        parent[next] = order[i];
+        via[next] = k;
+        order.push_back(next);
+      }
+    }
+
+    table.products_.resize(n * n);
+    table.inverses_.resize(n);
+    for (size_t a = 0; a < n; a++) {
+      Index* row = &table.products_[a * n];
+      row[table.identity_] = a;
+      for (size_t i = 1; i < order.size(); i++) {
+        Index b = order[i];
+        row[b] = gen_columns[via[b] * n + row[parent[b]]];
+      }
+      for (size_t b = 0; b < n; b++) {
+        if (row[b] == table.identity_) table.inverses_[a] = b;
+      }
+    }
+    return table;
+  }
+
+  size_t size() const { return elements_.size(); }
+  Index identity() const { return identity_; }
+  // Indices of the group's generators.
+  const std::vector<Index>& generators() const { return generators_; }
+
+  Index Multiply(Index a, Index b) const {
+    return products_[a * elements_.size() + b];
+  }
+  Index Inverse(Index a) const { return inverses_[a]; }
+  // b^-1 * a * b.
+  Index Conjugate(Index a, Index b) const {
+    return Multiply(Inverse(b), Multiply(a, b));
+  }
+  // All products a * b for a fixed a, indexed by b.
+  const Index* Row(Index a) const { return &products_[a * elements_.size()]; }
+
+  // Conversions between elements and indices. The indices follow the order
+  // of the elements in the group.
+  const E& Element(Index i) const { return elements_[i]; }
+  std::optional<Index> IndexOf(const E& e) const {
+    auto it = std::lower_bound(elements_.begin(), elements_.end(), e);
+    if (it == elements_.end() || *it != e) return std::nullopt;
+    return it - elements_.begin();
+  }
+  const std::vector<E>& elements() const { return elements_; }
+
+ private:
+  CayleyTable() = default;
+
+  std::vector<E> elements_;
+  Index identity_;
+  std::vector<Index> generators_;
+  // Row-major: products_[a * |G| + b] is a * b.
+  std::vector<Index> products_;
+  std::vector<Index> inverses_;
+};
+
+} // namespace groups
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef ALGEBRA_CONJUGACY_H_
+#define ALGEBRA_CONJUGACY_H_
+
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <ostream>
+#include <vector>
+
+#include "cayley_table.h"
+#include "group.h"
+#include "permutations.h"
+
+// Conjugacy classes and the class equation.
+//
+// The conjugacy classes are the orbits of the group acting on itself by
+// conjugation, and an orbit under a group is an orbit under its generators. So
+// the elements are numbered, and x is merged with s^-1 * x * s for each
+// generator s in a union-find. That is O(|G| * |generators|) conjugations.
+// For the full symmetric group, classes are cycle types, which is O(N) per
+// element and no products at all.
+
+namespace groups {
+
+template <GroupElement E>
+struct ConjugacyClasses {
+  // The smallest element of each class. The identity's class comes first, and
+  // the rest are ordered by size, then by representative.
+  std::vector<E> representatives;
+  std::vector<size_t> sizes;
+  // |C_G(x)| = |G| / |class of x|.
+  std::vector<size_t> centralizer_orders;
+  size_t group_order;
+};
+
+// Prints the class equation, e.g. "24 = 1 + 3 + 6 + 6 + 8".
+template <GroupElement E>
+std::ostream& operator<<(std::ostream& o, const ConjugacyClasses<E>& classes) {
+  o << classes.group_order << " =";
+  for (size_t i = 0; i < classes.sizes.size(); i++) {
+    o << (i == 0 ? " " : " + ") << classes.sizes[i];
+  }
+  return o;
+}
+
+namespace internal {
+
+// Union-find over dense indices, with path halving and union by size.
+class DisjointSets {
+ public:
+  explicit DisjointSets(size_t n) : parent_(n), size_(n, 1) {
+    std::iota(parent_.begin(), parent_.end(), 0);
+  }
+  size_t Find(size_t x) {
+    while (parent_[x] != x) {
+      parent_[x] = parent_[parent_[x]];
+      x = parent_[x];
+    }
+    return x;
+  }
+  void Union(size_t a, size_t b) {
+    a = Find(a);
+    b = Find(b);
+    if (a == b) return;
+    if (size_[a] < size_[b]) std::swap(a, b);
+    parent_[b] = a;
+    size_[a] += size_[b];
+  }
+  size_t SizeOf(size_t x) { return size_[Find(x)]; }
+
+ private:
+  std::vector<size_t> parent_;
+  std::vector<size_t> size_;
+};
+
+// Turns a class label per element (elements in increasing order) into the
+// result. Labels only need to be equal within a class. elements[identity] is
+// the identity.
+template <GroupElement E, typename Label>
+ConjugacyClasses<E> GatherClasses(const std::vector<E>& elements,
+                                  const std::vector<Label>& labels,
+                                  size_t identity) {
+  // Elements are sorted, so the first element seen with a label is the
+  // smallest in its class.
+  std::map<Label, size_t> first;
+  std::map<Label, size_t> count;
+  for (size_t i = 0; i < elements.size(); i++) {
+    first.emplace(labels[i], i);
+    count[labels[i]]++;
+  }
+  std::vector<std::pair<size_t, size_t>> classes;  // (size, first index)
+  for (const auto& [label, index]: first) {
+    classes.emplace_back(count[label], index);
+  }
+  // The identity's class has size 1, the smallest there is, but operator<
+  // needn't put the identity before the other central elements.
+  std::sort(classes.begin(), classes.end(),
+            [&](const auto& a, const auto& b) {
+              const bool a_identity = labels[a.second] == labels[identity];
+              const bool b_identity = labels[b.second] == labels[identity];
+              if (a_identity != b_identity) return a_identity;
+              return a < b;
+            });
+  ConjugacyClasses<E> result;
+  result.group_order = elements.size();
+  for (const auto& [size, index]: classes) {
+    result.representatives.push_back(elements[index]);
+    result.sizes.push_back(size);
+    result.centralizer_orders.push_back(elements.size() / size);
+  }
+  return result;
+}
+
+} // namespace internal
+
+// Classes from a multiplication table, with no calls to E::operator*.
+template <GroupElement E, std::unsigned_integral Index>
+ConjugacyClasses<E> ComputeConjugacyClasses(
+    const CayleyTable<E, Index>& table) {
+  internal::DisjointSets sets(table.size());
+  for (size_t x = 0; x < table.size(); x++) {
+    for (Index s: table.generators()) sets.Union(x, table.Conjugate(x, s));
+  }
+  std::vector<size_t> labels(table.size());
+  for (size_t x = 0; x < table.size(); x++) labels[x] = sets.Find(x);
+  return internal::GatherClasses(table.elements(), labels, table.identity());
+}
+
+template <GroupElement E, ElementStorage<E> Storage>
+ConjugacyClasses<E> ComputeConjugacyClasses(const Group<E, Storage>& group) {
+  const std::vector<E> elements(group.elements().begin(),
+                                group.elements().end());
+  auto index_of = [&elements](const E& e) {
+    return std::lower_bound(elements.begin(), elements.end(), e)
+        - elements.begin();
+  };
+  internal::DisjointSets sets(elements.size());
+  for (const E& s: group.generators()) {
+    const E s_inverse = -s;
+    for (size_t x = 0; x < elements.size(); x++) {
+      sets.Union(x, index_of(s_inverse * elements[x] * s));
+    }
+  }
+  std::vector<size_t> labels(elements.size());
+  for (size_t x = 0; x < elements.size(); x++) labels[x] = sets.Find(x);
+  return internal::GatherClasses(elements, labels, index_of(group.identity()));
+}
+
+// For permutations, the full symmetric group is classified by cycle type. In
+// a proper subgroup classes of S_N can split, so those go the generic way.
+template <size_t N>
+ConjugacyClasses<Permutation<N>> ComputeConjugacyClasses(
+    const Group<Permutation<N>>& group) {
+  size_t factorial = 1;
+  for (size_t i = 2; i <= N; i++) factorial *= i;
+  if (group.elements().size() != factorial) {
+    return ComputeConjugacyClasses<Permutation<N>>(group);
+  }
+  const std::vector<Permutation<N>> elements(group.elements().begin(),
+                                             group.elements().end());
+  std::vector<std::vector<int>> labels;
+  labels.reserve(elements.size());
+  for (const Permutation<N>& p: elements) labels.push_back(p.CycleType());
+  // The identity is the smallest permutation.
+  return internal::GatherClasses(elements, labels, 0);
+}
+
+} // namespace groups
+
+#endif
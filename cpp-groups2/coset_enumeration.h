@@ -0,0 +1,461 @@
+#ifndef ALGEBRA_COSET_ENUMERATION_H_
+#define ALGEBRA_COSET_ENUMERATION_H_
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "permutations.h"
+
+// Todd-Coxeter coset enumeration, for groups given by a presentation rather
+// than an element type.
+//
+// Given generators, relators and words generating a subgroup H, enumeration
+// numbers the right cosets of H and fills in a table of how each generator
+// (and inverse) moves them. When H has finite index this terminates with the
+// complete table, and the action on cosets is a permutation representation of
+// the group: with H trivial, the cosets are the group's elements and the
+// representation is the regular one.
+//
+// The table is a flat std::vector<int32_t> with a row of 2 * generators
+// entries per coset, plus one int32_t per coset for the union-find that merges
+// cosets found to be equal, so a coset costs 4 * (2 * generators + 1) bytes.
+// Two strategies are provided:
+// - HLT (Haselgrove, Leech and Trotter) scans each relator from each coset in
+//   turn and defines whatever cosets that needs. It is fast per coset but can
+//   define many more cosets than the index before coincidences cut them down.
+// - Felsch defines one coset at a time, in order, and scans every relator
+//   through each new table entry before the next. It defines far fewer
+//   redundant cosets, at the cost of more scanning.
+// The number of cosets alive at once, over the index, is the fill factor in
+// CosetEnumerationStats; its product with the bytes per coset is the memory
+// the enumeration really needs.
+
+namespace groups {
+
+// The group <x_1, ..., x_n | relators>, and the subgroup whose cosets are to
+// be enumerated.
+struct Presentation {
+  // A word is a list of letters: g for the generator x_g (1 <= g <= n) and -g
+  // for its inverse. For example, {1, 1, -2} is x_1 x_1 x_2^-1.
+  typedef std::vector<int> Word;
+
+  int generators = 0;
+  std::vector<Word> relators;
+  // Words generating the subgroup H. Empty for the trivial subgroup.
+  std::vector<Word> subgroup;
+
+  // Whether every letter is a generator or an inverse of one.
+  bool Valid() const {
+    auto valid = [&](const Word& w) {
+      return std::all_of(w.begin(), w.end(), [&](int letter) {
+        return letter != 0 && letter >= -generators && letter <= generators;
+      });
+    };
+    return generators >= 0 &&
+           std::all_of(relators.begin(), relators.end(), valid) &&
+           std::all_of(subgroup.begin(), subgroup.end(), valid);
+  }
+};
+
+enum class CosetStrategy { kHlt, kFelsch };
+
+struct CosetEnumerationOptions {
+  CosetStrategy strategy = CosetStrategy::kHlt;
+  // The most memory the coset table may use. Enumeration fails once it would
+  // need more cosets than fit, counting cosets that have been merged away
+  // until the table is compacted to reclaim them.
+  size_t max_bytes = size_t{1} << 30;
+};
+
+struct CosetEnumerationStats {
+  // Cosets defined over the whole enumeration, and how many of them were
+  // found to equal another coset and deleted.
+  size_t cosets_defined = 0;
+  size_t coincidences = 0;
+  // The most cosets alive at once, and the number at the end.
+  size_t peak_cosets = 0;
+  size_t index = 0;
+  // Times the table was compacted to reuse the rows of deleted cosets.
+  size_t compactions = 0;
+  size_t bytes_per_coset = 0;
+  std::chrono::nanoseconds time{0};
+
+  // peak_cosets over the index: 1 if no redundant coset was ever defined.
+  double fill_factor() const {
+    return index == 0 ? 0 : static_cast<double>(peak_cosets) / index;
+  }
+  size_t peak_bytes() const { return peak_cosets * bytes_per_coset; }
+};
+
+namespace coset_internal {
+
+constexpr int32_t kUndefined = -1;
+
+// The table column of a letter: 2(g - 1) for x_g and 2(g - 1) + 1 for its
+// inverse, so that the column of the inverse letter is always column ^ 1.
+inline int Column(int letter) {
+  return letter > 0 ? 2 * (letter - 1) : 2 * (-letter - 1) + 1;
+}
+
+class Enumerator {
+ public:
+  Enumerator(const Presentation& presentation,
+             const CosetEnumerationOptions& options)
+    : columns_(2 * presentation.generators),
+      felsch_(options.strategy == CosetStrategy::kFelsch) {
+    bytes_per_coset_ = sizeof(int32_t) * (columns_ + 1);
+    capacity_ = std::min<size_t>(options.max_bytes / bytes_per_coset_,
+                                 INT32_MAX);
+    for (const Presentation::Word& w: presentation.relators) {
+      relators_.push_back(Columns(w));
+    }
+    for (const Presentation::Word& w: presentation.subgroup) {
+      subgroup_.push_back(Columns(w));
+    }
+    // The largest number of cosets one coset's scans can define, so that the
+    // table can be compacted before it fills up in the middle of them.
+    margin_ = columns_ + 1;
+    for (const auto& r: relators_) margin_ += r.size();
+    if (felsch_) {
+      // Every cyclic permutation of every relator and its inverse, by first
+      // letter. A new entry in column x of a coset needs the ones starting
+      // with x scanned from it.
+      std::set<std::vector<int>> conjugates;
+      for (const auto& r: relators_) {
+        std::vector<int> inverse(r.rbegin(), r.rend());
+        for (int& x: inverse) x ^= 1;
+        for (const std::vector<int>& w: {r, inverse}) {
+          for (size_t i = 0; i < w.size(); i++) {
+            std::vector<int> conjugate(w.begin() + i, w.end());
+            conjugate.insert(conjugate.end(), w.begin(), w.begin() + i);
+            conjugates.insert(std::move(conjugate));
+          }
+        }
+      }
+      starting_with_.resize(columns_);
+      for (const auto& c: conjugates) starting_with_[c[0]].push_back(c);
+    }
+  }
+
+  // Runs the enumeration. Returns false if the table outgrew the memory cap.
+  bool Run() {
+    if (capacity_ == 0) return false;
+    NewCoset();
+    for (const auto& w: subgroup_) {
+      if (!ScanAndFill(0, w)) return false;
+    }
+    if (felsch_) ProcessDeductions();
+    for (int32_t a = 0; a < Size(); a++) {
+      if (Size() + margin_ > capacity_ && live_ < static_cast<size_t>(Size())) {
+        a = Compact(a);
+        // Every live coset before a has already been processed.
+        if (a >= Size()) break;
+      }
+      if (!Live(a)) continue;
+      if (felsch_) {
+        for (int x = 0; x < columns_ && Live(a); x++) {
+          if (T(a, x) != kUndefined) continue;
+          if (!Define(a, x)) return false;
+          ProcessDeductions();
+        }
+      } else {
+        for (size_t r = 0; r < relators_.size() && Live(a); r++) {
+          if (!ScanAndFill(a, relators_[r])) return false;
+        }
+        for (int x = 0; x < columns_ && Live(a); x++) {
+          if (T(a, x) == kUndefined && !Define(a, x)) return false;
+        }
+      }
+    }
+    Compact(0);
+    return true;
+  }
+
+  // The index and the table, once Run has succeeded.
+  size_t Index() const { return live_; }
+  std::vector<int32_t> Table() && { return std::move(table_); }
+
+  void Record(CosetEnumerationStats* stats) const {
+    stats->cosets_defined = defined_;
+    stats->coincidences = coincidences_;
+    stats->peak_cosets = peak_;
+    stats->index = live_;
+    stats->compactions = compactions_;
+    stats->bytes_per_coset = bytes_per_coset_;
+  }
+
+ private:
+  static std::vector<int> Columns(const Presentation::Word& w) {
+    std::vector<int> columns(w.size());
+    std::transform(w.begin(), w.end(), columns.begin(), Column);
+    return columns;
+  }
+
+  int32_t Size() const { return parent_.size(); }
+  bool Live(int32_t c) const { return parent_[c] == c; }
+  int32_t& T(int32_t c, int x) {
+    return table_[static_cast<size_t>(c) * columns_ + x];
+  }
+
+  void NewCoset() {
+    // Grow geometrically, but never past the cap.
+    if (parent_.size() == parent_.capacity()) {
+      const size_t cosets = std::min(capacity_, 2 * parent_.size() + 64);
+      parent_.reserve(cosets);
+      table_.reserve(cosets * columns_);
+    }
+    parent_.push_back(Size());
+    table_.resize(table_.size() + columns_, kUndefined);
+    live_++;
+    peak_ = std::max(peak_, live_);
+  }
+
+  // Defines a new coset as c's image under column x. Returns false if the
+  // table is full.
+  bool Define(int32_t c, int x) {
+    if (static_cast<size_t>(Size()) >= capacity_) return false;
+    NewCoset();
+    defined_++;
+    Deduce(c, x, Size() - 1);
+    return true;
+  }
+
+  // Sets c * x = d, and so d * x^-1 = c.
+  void Deduce(int32_t c, int x, int32_t d) {
+    T(c, x) = d;
+    T(d, x ^ 1) = c;
+    if (felsch_) deductions_.emplace_back(c, x);
+  }
+
+  // Traces w from c forwards and from c backwards, as far as the table is
+  // defined. If they meet, the ends are the same coset; if they are one
+  // letter apart, that letter's entry is deduced. If fill, cosets are defined
+  // until one of those happens. Returns false if the table is full.
+  bool Scan(int32_t c, const std::vector<int>& w, bool fill) {
+    int32_t f = c, b = c;
+    int i = 0, j = static_cast<int>(w.size()) - 1;
+    while (true) {
+      while (i <= j && T(f, w[i]) != kUndefined) f = T(f, w[i++]);
+      if (i > j) {
+        if (f != c) Coincidence(f, c);
+        return true;
+      }
+      while (j >= i && T(b, w[j] ^ 1) != kUndefined) b = T(b, w[j--] ^ 1);
+      if (j < i) {
+        Coincidence(f, b);
+        return true;
+      }
+      if (i == j) {
+        Deduce(f, w[i], b);
+        return true;
+      }
+      if (!fill) return true;
+      if (!Define(f, w[i])) return false;
+    }
+  }
+  bool ScanAndFill(int32_t c, const std::vector<int>& w) {
+    return Scan(c, w, true);
+  }
+
+  // Scans the relators through each new table entry (Felsch).
+  void ProcessDeductions() {
+    while (!deductions_.empty()) {
+      const auto [c, x] = deductions_.back();
+      deductions_.pop_back();
+      if (Live(c)) {
+        for (const auto& w: starting_with_[x]) {
+          Scan(c, w, false);
+          if (!Live(c)) break;
+        }
+      }
+      if (!Live(c)) continue;
+      const int32_t d = T(c, x);
+      if (d == kUndefined || !Live(d)) continue;
+      for (const auto& w: starting_with_[x ^ 1]) {
+        Scan(d, w, false);
+        if (!Live(d)) break;
+      }
+    }
+  }
+
+  int32_t Rep(int32_t c) {
+    int32_t root = c;
+    while (parent_[root] != root) root = parent_[root];
+    while (parent_[c] != root) c = std::exchange(parent_[c], root);
+    return root;
+  }
+
+  // Records that a and b are the same coset, keeping the smaller number.
+  void Merge(int32_t a, int32_t b) {
+    a = Rep(a);
+    b = Rep(b);
+    if (a == b) return;
+    if (a > b) std::swap(a, b);
+    parent_[b] = a;
+    queue_.push_back(b);
+    live_--;
+    coincidences_++;
+  }
+
+  // Merges a and b, and then everything that follows from it: if two merged
+  // cosets have different images under the same letter, those are merged
+  // too. The rows of deleted cosets are moved onto their representatives.
+  void Coincidence(int32_t a, int32_t b) {
+    queue_.clear();
+    Merge(a, b);
+    for (size_t k = 0; k < queue_.size(); k++) {
+      const int32_t g = queue_[k];
+      for (int x = 0; x < columns_; x++) {
+        const int32_t d = T(g, x);
+        if (d == kUndefined) continue;
+        T(d, x ^ 1) = kUndefined;
+        const int32_t m = Rep(g), n = Rep(d);
+        if (T(m, x) != kUndefined) {
+          Merge(n, T(m, x));
+        } else if (T(n, x ^ 1) != kUndefined) {
+          Merge(m, T(n, x ^ 1));
+        } else {
+          Deduce(m, x, n);
+        }
+      }
+    }
+  }
+
+  // Renumbers the live cosets 0, 1, ... in order, dropping the rows of
+  // deleted ones. Returns the new number of the first live coset at or after
+  // a.
+  int32_t Compact(int32_t a) {
+    std::vector<int32_t> renumber(Size(), kUndefined);
+    int32_t next = 0, new_a = -1;
+    for (int32_t c = 0; c < Size(); c++) {
+      if (c == a) new_a = next;
+      if (Live(c)) renumber[c] = next++;
+    }
+    if (new_a < 0) new_a = next;
+    for (int32_t c = 0; c < Size(); c++) {
+      if (!Live(c)) continue;
+      for (int x = 0; x < columns_; x++) {
+        const int32_t d = T(c, x);
+        table_[static_cast<size_t>(renumber[c]) * columns_ + x] =
+            d == kUndefined ? kUndefined : renumber[d];
+      }
+    }
+    table_.resize(static_cast<size_t>(next) * columns_);
+    parent_.resize(next);
+    for (int32_t c = 0; c < next; c++) parent_[c] = c;
+    compactions_++;
+    return new_a;
+  }
+
+  const int columns_;
+  const bool felsch_;
+  size_t bytes_per_coset_;
+  size_t capacity_;
+  size_t margin_;
+  std::vector<std::vector<int>> relators_;
+  std::vector<std::vector<int>> subgroup_;
+  std::vector<std::vector<std::vector<int>>> starting_with_;
+
+  std::vector<int32_t> table_;
+  std::vector<int32_t> parent_;
+  std::vector<std::pair<int32_t, int>> deductions_;
+  std::vector<int32_t> queue_;
+
+  size_t live_ = 0;
+  size_t peak_ = 0;
+  size_t defined_ = 0;
+  size_t coincidences_ = 0;
+  size_t compactions_ = 0;
+};
+
+} // namespace coset_internal
+
+// The complete coset table of a subgroup of finite index. Cosets are numbered
+// 0, ..., index() - 1, with 0 the subgroup itself.
+class CosetTable {
+ public:
+  typedef Presentation::Word Word;
+
+  // Enumerates the cosets of presentation.subgroup. std::nullopt is returned
+  // if the presentation uses letters it has no generator for, or if the
+  // enumeration needs more than options.max_bytes (which is how an infinite
+  // index shows up).
+  static std::optional<CosetTable> Enumerate(
+      const Presentation& presentation,
+      const CosetEnumerationOptions& options = CosetEnumerationOptions(),
+      CosetEnumerationStats* stats = nullptr) {
+    if (!presentation.Valid()) return std::nullopt;
+    const auto start = std::chrono::steady_clock::now();
+    coset_internal::Enumerator enumerator(presentation, options);
+    const bool done = enumerator.Run();
+    if (stats != nullptr) {
+      enumerator.Record(stats);
+      stats->time = std::chrono::steady_clock::now() - start;
+    }
+    if (!done) return std::nullopt;
+    const size_t index = enumerator.Index();
+    return CosetTable(presentation.generators, index,
+                      std::move(enumerator).Table());
+  }
+
+  size_t index() const { return index_; }
+  int generators() const { return generators_; }
+
+  // The coset c * letter, or c * w.
+  int32_t Act(int32_t c, int letter) const {
+    return table_[static_cast<size_t>(c) * 2 * generators_ +
+                  coset_internal::Column(letter)];
+  }
+  int32_t Act(int32_t c, const Word& w) const {
+    for (int letter: w) c = Act(c, letter);
+    return c;
+  }
+
+  // The permutation of the cosets by w, as a Permutation<N> sending c to
+  // c * w^-1 (and fixing N - index() points above the cosets). The inverse
+  // makes this a homomorphism, since Permutation composes right to left and
+  // cosets are acted on from the right. std::nullopt if index() > N.
+  template <size_t N>
+  std::optional<Permutation<N>> Image(const Word& w) const {
+    if (index() > N) return std::nullopt;
+    std::array<int, N> dests;
+    for (size_t c = 0; c < N; c++) {
+      int32_t d = c;
+      if (c < index()) {
+        for (size_t i = w.size(); i-- > 0;) d = Act(d, -w[i]);
+      }
+      dests[c] = d;
+    }
+    return Permutation<N>::Create(dests);
+  }
+
+  // The images of the generators, to build the group they act as with
+  // Group<Permutation<N>>::Create. With the trivial subgroup, that group is
+  // isomorphic to the presented one. std::nullopt if index() > N.
+  template <size_t N>
+  std::optional<std::set<Permutation<N>>> PermutationGenerators() const {
+    if (index() > N) return std::nullopt;
+    std::set<Permutation<N>> images;
+    for (int g = 1; g <= generators_; g++) images.insert(*Image<N>({g}));
+    return images;
+  }
+
+ private:
+  CosetTable(int generators, size_t index, std::vector<int32_t> table)
+    : generators_(generators), index_(index), table_(std::move(table)) {}
+
+  int generators_;
+  size_t index_;
+  // Row-major: table_[c * 2 * generators_ + Column(letter)] is c * letter.
+  std::vector<int32_t> table_;
+};
+
+} // namespace groups
+
+#endif
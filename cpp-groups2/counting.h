@@ -0,0 +1,116 @@
+#ifndef ALGEBRA_COUNTING_H_
+#define ALGEBRA_COUNTING_H_
+
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <ostream>
+#include <set>
+
+#include "group.h"
+
+// Instrumentation for finding out where a group computation spends its time.
+//
+// CountingElement<E> behaves exactly like E, but tallies each product,
+// inversion and comparison in thread-local counters. Build the group on
+// CountingElement<E> instead of E (e.g. with CountingElements below) and read
+// OperationCounts::Current() afterwards. Comparisons are mostly the std::set
+// in Group::Create, so they show how much of a build is spent searching it.
+// Counters are per thread, so a multi-threaded computation (such as
+// ParallelClosure) needs each worker's counts added up.
+//
+// Allocations are counted too when exactly one translation unit of the program
+// defines ALGEBRA_COUNT_ALLOCATIONS before including this header. That unit
+// then replaces the global operator new and delete with malloc and free plus a
+// count in ThreadAllocations() (group.h), which CreateStats reads.
+
+namespace groups {
+
+struct OperationCounts {
+  uint64_t products = 0;
+  uint64_t inversions = 0;
+  uint64_t less_comparisons = 0;
+  uint64_t equality_comparisons = 0;
+
+  uint64_t comparisons() const {
+    return less_comparisons + equality_comparisons;
+  }
+
+  // The counts for this thread.
+  static OperationCounts& Current() {
+    thread_local OperationCounts counts;
+    return counts;
+  }
+  static void Reset() { Current() = OperationCounts(); }
+
+  friend std::ostream& operator<<(std::ostream& o, const OperationCounts& c) {
+    return o << "products: " << c.products << ", inversions: " << c.inversions
+             << ", < comparisons: " << c.less_comparisons
+             << ", == comparisons: " << c.equality_comparisons;
+  }
+};
+
+// GroupElement.
+template <GroupElement E>
+class CountingElement {
+ public:
+  CountingElement(const E& e) : e_(e) {}
+
+  CountingElement<E> operator*(const CountingElement<E>& other) const {
+    OperationCounts::Current().products++;
+    return e_ * other.e_;
+  }
+  CountingElement<E> operator-() const {
+    OperationCounts::Current().inversions++;
+    return -e_;
+  }
+
+  bool operator<(const CountingElement<E>& other) const {
+    OperationCounts::Current().less_comparisons++;
+    return e_ < other.e_;
+  }
+  bool operator==(const CountingElement<E>& other) const {
+    OperationCounts::Current().equality_comparisons++;
+    return e_ == other.e_;
+  }
+
+  // The wrapped element.
+  const E& value() const { return e_; }
+
+  friend std::ostream& operator<<(std::ostream& o, const CountingElement<E>& c)
+  requires requires(E e, std::ostream s) { s << e; } {
+    return o << c.e_;
+  }
+
+ private:
+  E e_;
+};
+
+// Wraps each element of a set, e.g. to count the products of
+// Group<CountingElement<E>>::Create(CountingElements(generators)).
+template <GroupElement E>
+std::set<CountingElement<E>> CountingElements(const std::set<E>& elements) {
+  return std::set<CountingElement<E>>(elements.begin(), elements.end());
+}
+
+} // namespace groups
+
+template <groups::GroupElement E>
+struct std::hash<groups::CountingElement<E>> {
+  size_t operator()(const groups::CountingElement<E>& c) const {
+    return std::hash<E>{}(c.value());
+  }
+};
+
+#ifdef ALGEBRA_COUNT_ALLOCATIONS
+void* operator new(std::size_t size) {
+  groups::ThreadAllocations()++;
+  if (void* p = std::malloc(size == 0 ? 1 : size)) return p;
+  throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+#endif
+
+#endif
@@ -0,0 +1,169 @@
+#ifndef ALGEBRA_ELEMENT_STORAGE_H_
+#define ALGEBRA_ELEMENT_STORAGE_H_
+
+#include <algorithm>
+#include <memory>
+#include <memory_resource>
+#include <numeric>
+#include <set>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "group.h"
+
+// Alternatives to std::set for the elements of a Group, as its Storage
+// parameter: Group<E, FlatSet<E>> or Group<E, ArenaSet<E>>.
+//
+// A std::set allocates a node per element, with three pointers and a color
+// next to each element, plus the allocator's own header. Iterating it chases
+// those pointers all over the heap.
+// - FlatSet is a sorted std::vector. It costs sizeof(E) per element and
+//   iterates and searches contiguous memory. Single inserts are O(n), but
+//   Group::Create inserts a layer's products by one generator at a time,
+//   which is a sort and a merge.
+// - ArenaSet is still a red-black tree, but its nodes come from a bump
+//   allocator in large blocks, so there is no per-node allocation call or
+//   header, and nodes built together sit together.
+//
+// For S_9 (362880 elements of 36 bytes), measured with the storage cases in
+// benchmark.cpp:
+//   storage   build    peak RSS   20 passes over the elements
+//   std::set  673 ms   33 MiB     1542 ms
+//   FlatSet   451 ms   26 MiB       32 ms
+//   ArenaSet  715 ms   33 MiB     1538 ms
+// The peak includes the closure's frontier and products, which are the same
+// for every backend; the elements alone are about 88 bytes each in a std::set
+// and 36 in a FlatSet. ArenaSet only saves the allocator's per-node overhead,
+// and since its nodes are laid out in the order they were found rather than
+// sorted order, iterating it is no faster.
+
+namespace groups {
+
+// A sorted vector of unique elements.
+template <GroupElement E>
+class FlatSet {
+ public:
+  typedef typename std::vector<E>::const_iterator const_iterator;
+  typedef const_iterator iterator;
+
+  FlatSet() = default;
+
+  // Inserts e, keeping the vector sorted. O(size()); prefer BatchInsert.
+  std::pair<const_iterator, bool> insert(const E& e) {
+    auto it = std::lower_bound(elements_.begin(), elements_.end(), e);
+    if (it != elements_.end() && *it == e) return {it, false};
+    it = elements_.insert(it, e);
+    return {it, true};
+  }
+
+  bool contains(const E& e) const { return find(e) != end(); }
+  const_iterator find(const E& e) const {
+    auto it = std::lower_bound(elements_.begin(), elements_.end(), e);
+    return it != elements_.end() && *it == e ? it : end();
+  }
+
+  size_t size() const { return elements_.size(); }
+  bool empty() const { return elements_.empty(); }
+  const_iterator begin() const { return elements_.begin(); }
+  const_iterator end() const { return elements_.end(); }
+  // The elements, which are contiguous and sorted.
+  const std::vector<E>& vector() const { return elements_; }
+
+  bool operator==(const FlatSet<E>& other) const = default;
+
+ private:
+  friend struct BatchInsert<FlatSet<E>, E>;
+
+  std::vector<E> elements_;
+};
+
+// Sorts the batch, drops what's already there (and repeats within the batch,
+// keeping the first), and merges the rest in. O(m log m + n) for m new
+// candidates and n elements.
+template <GroupElement E>
+struct BatchInsert<FlatSet<E>, E> {
+  static void Insert(FlatSet<E>* storage, std::span<const E> xs,
+                     std::vector<bool>* is_new) {
+    is_new->assign(xs.size(), false);
+    std::vector<size_t> order(xs.size());
+    std::iota(order.begin(), order.end(), 0);
+    // Stable, so that the first of equal elements comes first.
+    std::stable_sort(order.begin(), order.end(),
+                     [&](size_t a, size_t b) { return xs[a] < xs[b]; });
+
+    std::vector<E>& elements = storage->elements_;
+    const size_t old_size = elements.size();
+    auto existing = elements.begin();
+    const E* previous = nullptr;
+    for (size_t i: order) {
+      const E& x = xs[i];
+      if (previous != nullptr && *previous == x) continue;
+      previous = &x;
+      existing = std::lower_bound(existing, elements.begin() + old_size, x);
+      if (existing != elements.begin() + old_size && *existing == x) continue;
+      (*is_new)[i] = true;
+    }
+    // The new elements were found in sorted order.
+    for (size_t i: order) {
+      if ((*is_new)[i]) elements.push_back(xs[i]);
+    }
+    std::inplace_merge(elements.begin(), elements.begin() + old_size,
+                       elements.end());
+  }
+};
+
+// A std::set whose nodes come from a monotonic arena owned by the set. Nodes
+// are never freed individually, so erasing isn't supported; the arena goes
+// when the set does.
+template <GroupElement E>
+class ArenaSet {
+ public:
+  typedef std::pmr::set<E> Set;
+  typedef typename Set::const_iterator const_iterator;
+  typedef const_iterator iterator;
+
+  ArenaSet() : state_(std::make_unique<State>()) {}
+  ArenaSet(const ArenaSet<E>& other) : ArenaSet() {
+    for (const E& e: other) state_->set.emplace_hint(state_->set.end(), e);
+  }
+  // Leaves other empty but usable, as a moved-from std::set is.
+  ArenaSet(ArenaSet<E>&& other) : ArenaSet() {
+    std::swap(state_, other.state_);
+  }
+  ArenaSet& operator=(ArenaSet<E> other) {
+    std::swap(state_, other.state_);
+    return *this;
+  }
+
+  std::pair<const_iterator, bool> insert(const E& e) {
+    return state_->set.insert(e);
+  }
+  bool contains(const E& e) const { return state_->set.contains(e); }
+  const_iterator find(const E& e) const { return state_->set.find(e); }
+
+  size_t size() const { return state_->set.size(); }
+  bool empty() const { return state_->set.empty(); }
+  const_iterator begin() const { return state_->set.begin(); }
+  const_iterator end() const { return state_->set.end(); }
+
+  bool operator==(const ArenaSet<E>& other) const {
+    return state_->set == other.state_->set;
+  }
+
+ private:
+  // The first block; the arena grows geometrically from there.
+  static constexpr size_t kBlock = 1 << 16;
+
+  // Together behind a pointer, so that moving the set doesn't move the arena
+  // its nodes point into.
+  struct State {
+    std::pmr::monotonic_buffer_resource arena{kBlock};
+    Set set{&arena};
+  };
+  std::unique_ptr<State> state_;
+};
+
+} // namespace groups
+
+#endif
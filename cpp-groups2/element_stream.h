@@ -0,0 +1,264 @@
+#ifndef ALGEBRA_ELEMENT_STREAM_H_
+#define ALGEBRA_ELEMENT_STREAM_H_
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <numeric>
+#include <optional>
+#include <ostream>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "permutations.h"
+#include "stabilizer_chain.h"
+
+// Lazy enumeration of the elements of a group, without holding them all.
+//
+// Group<E> keeps every element, so everything that reads a Group needs all of
+// it in memory first. The ranges here produce elements one at a time, in a
+// fixed order, from a description of the group that doesn't grow with |G|:
+// - SymmetricElements<N> is S_N in increasing order (the order of a
+//   Group<Permutation<N>>), stepping with std::next_permutation. O(N) memory.
+// - ChainElements<N> is any permutation group given by a StabilizerChain, as
+//   products of one transversal element per level, counting through the
+//   levels like an odometer. Only the changed levels' prefix products are
+//   recomputed, so this is about one product per element, and O(N * depth)
+//   memory on top of the chain.
+// - RankedElements is [first, last) of any unranking function, such as
+//   Permutation<N>::Unrank or AbelianGroup::Element. Ranges of ranks split the
+//   work between threads or processes.
+// These are input ranges (begin() and a std::default_sentinel_t end()), so they
+// work with range-for and std::ranges algorithms. WriteElements and
+// WriteElementsBinary stream any of them out.
+
+namespace groups {
+
+namespace stream_internal {
+
+// The iterator for the ranges below, which keep their position in a State
+// with Get() and Advance() (false once past the end).
+template <typename State>
+class Iterator {
+ public:
+  typedef std::input_iterator_tag iterator_concept;
+  typedef std::ptrdiff_t difference_type;
+  typedef std::remove_cvref_t<decltype(std::declval<const State&>().Get())>
+      value_type;
+
+  Iterator() = default;
+  explicit Iterator(State state) : state_(std::move(state)), done_(false) {
+    done_ = state_.Done();
+  }
+
+  const value_type& operator*() const { return state_.Get(); }
+  Iterator& operator++() {
+    done_ = !state_.Advance();
+    return *this;
+  }
+  void operator++(int) { ++*this; }
+  bool operator==(std::default_sentinel_t) const { return done_; }
+
+ private:
+  State state_;
+  bool done_ = true;
+};
+
+} // namespace stream_internal
+
+// S_N in increasing order.
+template <size_t N>
+class SymmetricElements {
+ public:
+  class State {
+   public:
+    State() {
+      std::iota(dests_.begin(), dests_.end(), 0);
+      current_ = Permutation<N>::Identity();
+    }
+    bool Done() const { return false; }
+    const Permutation<N>& Get() const { return current_; }
+    bool Advance() {
+      if (!std::next_permutation(dests_.begin(), dests_.end())) return false;
+      current_ = *Permutation<N>::Create(dests_);
+      return true;
+    }
+
+   private:
+    std::array<int, N> dests_;
+    Permutation<N> current_ = Permutation<N>::Identity();
+  };
+  typedef stream_internal::Iterator<State> iterator;
+
+  iterator begin() const { return iterator(State()); }
+  std::default_sentinel_t end() const { return {}; }
+};
+
+// The elements of the group with the given stabilizer chain, which must
+// outlive the range. The identity comes first.
+template <size_t N>
+class ChainElements {
+ public:
+  explicit ChainElements(const StabilizerChain<N>& chain) : chain_(&chain) {}
+
+  class State {
+   public:
+    State() = default;
+    explicit State(const StabilizerChain<N>* chain)
+      : chain_(chain), digits_(chain->depth(), 0),
+        prefixes_(chain->depth() + 1, Permutation<N>::Identity()) {}
+
+    bool Done() const { return false; }
+    // The product of the chosen transversal elements, which prefixes_ builds
+    // up level by level.
+    const Permutation<N>& Get() const { return prefixes_.back(); }
+    bool Advance() {
+      size_t i = digits_.size();
+      while (i > 0 && digits_[i - 1] + 1 == chain_->orbit(i - 1).size()) i--;
+      if (i == 0) return false;
+      digits_[i - 1]++;
+      prefixes_[i] = prefixes_[i - 1] *
+          chain_->transversal(i - 1, chain_->orbit(i - 1)[digits_[i - 1]]);
+      // The first point of every orbit is its base point, whose transversal
+      // element is the identity.
+      for (size_t j = i; j < digits_.size(); j++) {
+        digits_[j] = 0;
+        prefixes_[j + 1] = prefixes_[j];
+      }
+      return true;
+    }
+
+   private:
+    const StabilizerChain<N>* chain_ = nullptr;
+    std::vector<size_t> digits_;
+    std::vector<Permutation<N>> prefixes_;
+  };
+  typedef stream_internal::Iterator<State> iterator;
+
+  iterator begin() const { return iterator(State(chain_)); }
+  std::default_sentinel_t end() const { return {}; }
+
+ private:
+  const StabilizerChain<N>* chain_;
+};
+
+// unrank(first), ..., unrank(last - 1).
+template <typename Unrank>
+class RankedElements {
+ public:
+  RankedElements(Unrank unrank, uint64_t first, uint64_t last)
+    : unrank_(std::move(unrank)), first_(first), last_(last) {}
+
+  class State {
+   public:
+    State() = default;
+    State(const Unrank* unrank, uint64_t rank, uint64_t last)
+      : unrank_(unrank), rank_(rank), last_(last) {
+      if (rank_ < last_) current_ = (*unrank_)(rank_);
+    }
+    bool Done() const { return rank_ >= last_; }
+    const auto& Get() const { return *current_; }
+    bool Advance() {
+      if (++rank_ >= last_) return false;
+      current_ = (*unrank_)(rank_);
+      return true;
+    }
+
+   private:
+    const Unrank* unrank_ = nullptr;
+    uint64_t rank_ = 0;
+    uint64_t last_ = 0;
+    std::optional<std::invoke_result_t<const Unrank&, uint64_t>> current_;
+  };
+  typedef stream_internal::Iterator<State> iterator;
+
+  // The range holds the function, so it must outlive its iterators.
+  iterator begin() const { return iterator(State(&unrank_, first_, last_)); }
+  std::default_sentinel_t end() const { return {}; }
+
+ private:
+  Unrank unrank_;
+  uint64_t first_;
+  uint64_t last_;
+};
+
+// How WriteElements writes an element and its newline: with operator<< by
+// default. Types whose operator<< makes many small calls on the stream can
+// specialize this to format the same text into a buffer and write it at once.
+template <typename E>
+struct ElementText {
+  static void Write(std::ostream& o, const E& e) { o << e << '\n'; }
+};
+
+// "[ 0, 1, 2]", as Permutation's operator<<.
+template <size_t N>
+struct ElementText<Permutation<N>> {
+  static void Write(std::ostream& o, const Permutation<N>& p) {
+    // Each point takes at most 20 digits and ", ".
+    std::array<char, 4 + 22 * N> text;
+    char* out = text.data();
+    *out++ = '[';
+    *out++ = ' ';
+    for (size_t i = 0; i < N; i++) {
+      if (i > 0) {
+        *out++ = ',';
+        *out++ = ' ';
+      }
+      out = std::to_chars(out, text.data() + text.size(), p.Image(i)).ptr;
+    }
+    *out++ = ']';
+    *out++ = '\n';
+    o.write(text.data(), out - text.data());
+  }
+};
+
+// Writes each element as operator<< would, one per line, and returns how many
+// there were. Nothing is flushed until the end, so the stream's buffer sets
+// the size of the writes (for std::cout, call
+// std::ios::sync_with_stdio(false) first).
+template <typename Range>
+uint64_t WriteElements(std::ostream& o, Range&& elements) {
+  typedef std::remove_cvref_t<decltype(*std::ranges::begin(elements))> E;
+  uint64_t count = 0;
+  for (const auto& e: elements) {
+    ElementText<E>::Write(o, e);
+    count++;
+  }
+  o.flush();
+  return count;
+}
+
+// Writes the bytes of each element, back to back, and returns how many there
+// were. For element types with a unique object representation, such as
+// Permutation<N> (N ints each) and ModInt.
+template <typename Range>
+uint64_t WriteElementsBinary(std::ostream& o, Range&& elements) {
+  typedef std::remove_cvref_t<decltype(*std::ranges::begin(elements))> E;
+  static_assert(std::has_unique_object_representations_v<E>,
+                "elements are written as their bytes");
+  constexpr size_t kBlock = (1 << 16) / sizeof(E) + 1;
+  std::vector<E> buffer;
+  buffer.reserve(kBlock);
+  uint64_t count = 0;
+  auto flush = [&]() {
+    o.write(reinterpret_cast<const char*>(buffer.data()),
+            buffer.size() * sizeof(E));
+    count += buffer.size();
+    buffer.clear();
+  };
+  for (const auto& e: elements) {
+    buffer.push_back(e);
+    if (buffer.size() == kBlock) flush();
+  }
+  flush();
+  return count;
+}
+
+} // namespace groups
+
+#endif
@@ -3,10 +3,17 @@
 
 #include <array>
 #include <algorithm>
+#include <chrono>
 #include <concepts>
+#include <cstdint>
+#include <map>
 #include <optional>
 #include <ostream>
 #include <set>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 // The basic class that represents a finite group.
 //
@@ -32,11 +39,221 @@ concept GroupElement = requires(T e1, T e2) {
   std::totally_ordered<T>;
 };
 
-// A group of elements.
+// How a Group keeps its elements: a sorted container of unique elements that
+// iterates in the order of operator<. std::set is the default; see
+// element_storage.h for the others.
+template <typename S, typename E>
+concept ElementStorage = requires(S s, const S cs, E e) {
+  { s.insert(e).second } -> std::convertible_to<bool>;
+  { cs.contains(e) } -> std::convertible_to<bool>;
+  { cs.size() } -> std::convertible_to<size_t>;
+  { *cs.begin() } -> std::convertible_to<const E&>;
+  cs.end();
+};
+
+template <GroupElement E, ElementStorage<E> Storage = std::set<E>>
+class Group;
+
+template <GroupElement E>
+class ParallelClosure;
+
+template <GroupElement E>
+class MappedGroup;
+
+template <GroupElement... Es>
+requires (sizeof...(Es) > 0)
+class Product;
+
+template <GroupElement... Es>
+Group<Product<Es...>> DirectProduct(const Group<Es>&... factors);
+
+// Multiplies a whole batch of elements by one element, which is what the
+// closure in Group::Create does for each generator. Element types with a
+// faster way to do this in bulk can specialize it (see permutations.h), in the
+// same header as the element type, so that every Group<E> uses the same one.
+template <GroupElement E>
+struct BatchProduct {
+  // A batch that is multiplied by several elements in turn, such as a layer of
+  // the closure by each generator. Specializations can put xs into a better
+  // layout here, once per batch.
+  class Batch {
+   public:
+    explicit Batch(std::span<const E> xs) : xs_(xs) {}
+    // Appends x * g to out for each x in the batch, in order.
+    void RightMultiply(const E& g, std::vector<E>* out) const {
+      out->reserve(out->size() + xs_.size());
+      for (const E& x: xs_) out->push_back(x * g);
+    }
+
+   private:
+    std::span<const E> xs_;
+  };
+};
+
+// Powers and orders of elements. The generic versions only use * and unary -,
+// with exponentiation by squaring; element types that know their cycle
+// structure can specialize it (see permutations.h).
+template <GroupElement E>
+struct ElementPowers {
+  // e^k. Negative k are powers of the inverse, and e^0 is the identity.
+  // O(log |k|) products.
+  static E Pow(const E& e, int64_t k) {
+    const E identity = e * (-e);
+    E base = k < 0 ? -e : e;
+    uint64_t n = k < 0 ? -static_cast<uint64_t>(k) : k;
+    E result = identity;
+    for (; n > 0; n >>= 1) {
+      if (n & 1) result = result * base;
+      if (n > 1) base = base * base;
+    }
+    return result;
+  }
+
+  // The least n > 0 with e^n the identity, by walking the cycle of e. That is
+  // order(e) products, so prefer the overload below when a multiple of the
+  // order is known.
+  static uint64_t Order(const E& e) {
+    const E identity = e * (-e);
+    uint64_t order = 1;
+    for (E x = e; x != identity; x = x * e) order++;
+    return order;
+  }
+
+  // The order of e, given a multiple of it such as the order of a group that
+  // contains e. Each prime p is divided out of the multiple for as long as
+  // e^(multiple / p) is still the identity, which is O(log multiple) products
+  // per prime factor.
+  static uint64_t Order(const E& e, uint64_t multiple) {
+    const E identity = e * (-e);
+    uint64_t order = multiple;
+    uint64_t rest = multiple;
+    for (uint64_t p = 2; rest > 1; p++) {
+      if (p > rest / p) p = rest;
+      if (rest % p != 0) continue;
+      while (rest % p == 0) rest /= p;
+      while (order % p == 0 && Pow(e, order / p) == identity) order /= p;
+    }
+    return order;
+  }
+};
+
+template <GroupElement E>
+E Pow(const E& e, int64_t k) {
+  return ElementPowers<E>::Pow(e, k);
+}
+
+template <GroupElement E>
+uint64_t Order(const E& e) {
+  return ElementPowers<E>::Order(e);
+}
+
+// Heap allocations made by this thread so far. Nothing counts them unless a
+// translation unit defines ALGEBRA_COUNT_ALLOCATIONS before including
+// counting.h, which replaces the global operator new; otherwise this stays 0.
+inline uint64_t& ThreadAllocations() {
+  thread_local uint64_t allocations = 0;
+  return allocations;
+}
+
+// What Group::Create spent its time on, filled in when asked for. Combine it
+// with CountingElement (counting.h) to split the products out by kind.
+struct CreateStats {
+  // Step 1: walking the cycle of each generator.
+  std::chrono::nanoseconds cycle_time{0};
+  // Step 2: the breadth-first closure, including the element checks.
+  std::chrono::nanoseconds closure_time{0};
+  std::chrono::nanoseconds total_time{0};
+  // One entry per layer of the closure: the products computed in that layer.
+  // That is the layer's size times the number of generators, plus three per
+  // element of the layer for the identity and inverse checks.
+  std::vector<size_t> products_per_iteration;
+  // The largest frontier of the closure, and the number of elements at the
+  // end (which is the most there ever were, since elements are only added).
+  size_t peak_frontier = 0;
+  size_t peak_elements = 0;
+  // Heap allocations during the build, if they are being counted (see
+  // ThreadAllocations()).
+  uint64_t allocations = 0;
+
+  size_t iterations() const { return products_per_iteration.size(); }
+};
+
+// Inserts the elements of a layer of the closure in Group::Create into the
+// storage. is_new[i] is set if xs[i] was inserted, that is, if it wasn't in the
+// storage already and isn't a repeat of an earlier xs[j]. Storage that is
+// cheaper to update in bulk can specialize it (see element_storage.h).
+template <typename Storage, GroupElement E>
+struct BatchInsert {
+  static void Insert(Storage* storage, std::span<const E> xs,
+                     std::vector<bool>* is_new) {
+    is_new->assign(xs.size(), false);
+    for (size_t i = 0; i < xs.size(); i++) {
+      (*is_new)[i] = storage->insert(xs[i]).second;
+    }
+  }
+};
+
+// A spanning tree of the Cayley graph of a group, rooted at the identity.
 //
-// Implemented as a std::set of elements to avoid complications with hashing.
-// This also allows better reproducibility for outputs.
+// Every element other than the identity records the element it was reached
+// from and the generator that was applied to get there, such that
+// child == parent * generator. This gives a word over the generators for every
+// element of the group without any extra search.
 template <GroupElement E>
+class SchreierTree {
+ public:
+  // An empty tree, to be filled in by Group::Create.
+  SchreierTree() = default;
+
+  // Gets the word over the generators whose left-to-right product is e. The
+  // identity is the empty word. std::nullopt is returned if e is not in the
+  // tree.
+  std::optional<std::vector<E>> Word(const E& e) const {
+    if (!root_.has_value()) return std::nullopt;
+    std::vector<E> word;
+    const E* current = &e;
+    for (auto it = edges_.find(*current); *current != *root_;
+         it = edges_.find(*current)) {
+      if (it == edges_.end()) return std::nullopt;
+      word.push_back(it->second.second);
+      current = &it->second.first;
+    }
+    std::reverse(word.begin(), word.end());
+    return word;
+  }
+
+  // The parent and generator that reached e. Not set for the identity.
+  std::optional<std::pair<E, E>> Edge(const E& e) const {
+    auto it = edges_.find(e);
+    if (it == edges_.end()) return std::nullopt;
+    return it->second;
+  }
+
+  const E& root() const { return *root_; }
+  size_t size() const { return edges_.size() + 1; }
+
+ private:
+  template <GroupElement F, ElementStorage<F> Storage>
+  friend class Group;
+  void Reset(const E& root) {
+    root_ = root;
+    edges_.clear();
+  }
+  void Add(const E& child, const E& parent, const E& generator) {
+    edges_.emplace(child, std::make_pair(parent, generator));
+  }
+
+  // Optional only because E need not be default constructible.
+  std::optional<E> root_;
+  std::map<E, std::pair<E, E>> edges_;
+};
+
+// A group of elements.
+//
+// Implemented as a sorted set of elements to avoid complications with hashing.
+// This also allows better reproducibility for outputs. The set is a std::set
+// unless another Storage is given.
+template <GroupElement E, ElementStorage<E> Storage>
 class Group {
  public:
   // Creates the group from the elements if possible. However, the following
@@ -47,105 +264,296 @@ class Group {
   // std::nullopt is returned when the properties cannot be assured.
   // Since it requires a different, slower, traversal, assurances of
   // associativity are provided through a separate instance method.
-  // Note that this algorithm does not actually require associativity to run
-  // correctly, though a non-associative set of elements with a multiplication,
-  // identity, and inversion rule, do not define a group.
-  static std::optional<Group> Create(const std::set<E>& generators) {
-    std::set<E> elements;
-    std::optional<E> identity;
+  //
+  // The closure is a breadth-first search over the Cayley graph: each new
+  // element is only ever multiplied (on the right) by the generators, so this
+  // costs O(|G| * |generators|) products. Note that this relies on
+  // associativity: closure under right multiplication by the generators only
+  // implies closure under all products when * is associative. A
+  // non-associative set of elements with a multiplication, identity, and
+  // inversion rule does not define a group anyway.
+  //
+  // If tree is not null, it is filled with the Schreier tree of the search.
+  // If stats is not null, it is filled with timings and counts of the search,
+  // as far as it got.
+  static std::optional<Group> Create(const std::set<E>& generators,
+                                     SchreierTree<E>* tree = nullptr,
+                                     CreateStats* stats = nullptr) {
+    typedef std::chrono::steady_clock Clock;
+    const Clock::time_point start = Clock::now();
+    const uint64_t start_allocations = ThreadAllocations();
+    if (stats != nullptr) *stats = CreateStats();
+    // Times the phase that started at phase_start, and the whole build so far.
+    auto record = [&](std::chrono::nanoseconds CreateStats::*phase,
+                      Clock::time_point phase_start) {
+      if (stats == nullptr) return;
+      const Clock::time_point now = Clock::now();
+      stats->*phase += now - phase_start;
+      stats->total_time = now - start;
+      stats->allocations = ThreadAllocations() - start_allocations;
+    };
+
     // Step 1: copy in the generators and generate cycles.
-    // This feels like an optimization since cyclic groups and abelian
-    // groups would take far fewer Bellman-Ford iterations after this.
-    // This also provides some convenient checks and an opportunity to
-    // halt quickly if a group is larger than a certain size.
-    bool set_identity = false;
-    for(const E& g: generators) {
-      std::optional<E> prev;
-      for(E gn = g * g; gn != g; gn = g * gn) {
-	prev = gn;
-	elements.insert(gn);
+    // The cycles are also edges of the Cayley graph (g^(k+1) = g^k * g), so
+    // they seed the search below.
+    std::set<E> seed;
+    std::vector<std::pair<E, std::pair<E, E>>> cycle_edges;
+    std::optional<E> identity =
+        GenerateCycles(generators, &seed, &cycle_edges);
+    record(&CreateStats::cycle_time, start);
+    if (!identity.has_value()) return std::nullopt;
+    if (tree != nullptr) {
+      tree->Reset(*identity);
+      for (const E& g: generators) {
+        if (g != *identity) tree->Add(g, *identity, g);
       }
-      if (prev.has_value() && !identity.has_value()) {
-        identity = prev;
-      } else if (identity != prev) {
-	// If the identity is non-unique, the algorithm below may not work, so
-	// we quit while we're ahead.
-	return std::nullopt;
-      } else if (!prev.has_value()) {
-	// prev was unset because we saw the trivial group
-	if (generators.size() == 1) {
-	  return Group<E>(g, generators, true);
-	}
-	return std::nullopt;
+      // Cycles can overlap, but only the first edge into each element is
+      // kept, so this is still a tree.
+      for (const auto& [child, edge]: cycle_edges) {
+        if (child != *identity) tree->Add(child, edge.first, edge.second);
       }
-      elements.insert(g);
     }
 
+    Storage elements = ToStorage(std::move(seed));
+
     // Step 1b: run away if there's one generator
+    const Clock::time_point closure_start = Clock::now();
+    if (stats != nullptr) stats->peak_elements = elements.size();
     if(generators.size() == 1) {
-      return Group<E>(*identity, elements, true);
+      bool ok = true;
+      for (const E& x: elements) ok = ok && CheckElement(x, *identity);
+      record(&CreateStats::closure_time, closure_start);
+      if (!ok) return std::nullopt;
+      return Group(*identity, std::move(elements), generators, true);
     }
 
-    // Step 2: Bellman-Ford time.
-    // TODO: use temps to avoid redundant use of *.
-    bool abelian = true;
-    for(bool augmented = true; augmented;) {
-      augmented = false;
-      for (const E& x: elements) {
-	if (x * (-x) != *identity
-	    || x * *identity != x
-	    || *identity * x != x) return std::nullopt;
-	if (x == *identity) continue;
-	for (const E& y: elements) {
-	  if (y == *identity || x == y) continue;
-	  if (!elements.contains(x * y)) {
-	    // N.B. there's a potential optimization here that could be found by
-	    // observing that if x < x * y, the outer loop will run over x*y in
-	    // this Bellman-Ford iteration. However, this may conflate a lot of
-	    // weird things with non-abelian cases. Furthermore, it may
-	    // introduce an assumption of Abelianness which this formulation
-	    // seems not to.
-	    // The optimization needs benchmarks and is left to the reader as an
-	    // exercise.
-	    augmented = true;
-	    elements.insert(x * y);
-	    abelian = abelian && x * y == y * x;
-	    if (!elements.contains(y * x)) elements.insert(y * x);
-	  }
-	}
+    // Step 2: breadth-first search from everything found so far, one layer
+    // at a time. The layer is multiplied by one generator at a time, and
+    // those products are inserted before the next generator's are made, so
+    // only one generator's worth of products is held at once. The first
+    // product to reach an element (by generator, then position in the layer)
+    // is the one kept in the tree, whatever the storage.
+    bool abelian = GeneratorsCommute(generators);
+    const std::vector<E> gens(generators.begin(), generators.end());
+    std::vector<E> frontier(elements.begin(), elements.end());
+    std::vector<E> products;
+    std::vector<bool> is_new;
+    while (!frontier.empty()) {
+      if (stats != nullptr) {
+        stats->products_per_iteration.push_back(
+            frontier.size() * (generators.size() + 3));
+        stats->peak_frontier = std::max(stats->peak_frontier, frontier.size());
+      }
+      for (const E& x: frontier) {
+        if (!CheckElement(x, *identity)) {
+          record(&CreateStats::closure_time, closure_start);
+          return std::nullopt;
+        }
+      }
+      const typename BatchProduct<E>::Batch layer(frontier);
+      std::vector<E> next;
+      for (const E& g: gens) {
+        products.clear();
+        layer.RightMultiply(g, &products);
+        BatchInsert<Storage, E>::Insert(&elements, products, &is_new);
+        for (size_t i = 0; i < products.size(); i++) {
+          if (!is_new[i]) continue;
+          if (tree != nullptr) tree->Add(products[i], frontier[i], g);
+          next.push_back(std::move(products[i]));
+        }
       }
-    } // Bellman-Ford outer loop
-    return Group<E>(*identity, elements, abelian);
+      frontier = std::move(next);
+    }
+    if (stats != nullptr) {
+      stats->peak_elements = elements.size();
+      record(&CreateStats::closure_time, closure_start);
+    }
+    return Group(*identity, std::move(elements), generators, abelian);
+  }
+
+  // The group generated by group's generators and g, extending group rather
+  // than starting again. Pass group with std::move to reuse its storage.
+  //
+  // This is Dimino's algorithm. The new group is a union of right cosets
+  // H * r of the old group H: starting from H * g, each representative r is
+  // multiplied by every generator s, old and new, and H * (r * s) is added
+  // whenever r * s is a new element. Each new coset is one BatchProduct of
+  // H's elements, which are prepared as a batch once, so this is |G| - |H|
+  // products plus |generators| per coset, where Create would take
+  // |G| * |generators|. If g is already in H, H is returned straight away
+  // (with g among its generators).
+  //
+  // is_abelian() stays true only if g commutes with the old generators. New
+  // elements get the same identity and inverse checks as in Create, and
+  // std::nullopt is returned if one fails. If tree is not null, it must be a
+  // Schreier tree for group (as filled in by Create), and it is extended to
+  // the new elements, which takes another |G| - |H| products.
+  static std::optional<Group> AddGenerator(Group group, const E& g,
+                                           SchreierTree<E>* tree = nullptr) {
+    if (group.elements_.contains(g)) {
+      group.generators_.insert(g);
+      return group;
+    }
+    for (const E& s: group.generators_) {
+      group.abelian_ = group.abelian_ && s * g == g * s;
+    }
+    group.generators_.insert(g);
+    const std::vector<E> subgroup(group.elements_.begin(),
+                                  group.elements_.end());
+    const typename BatchProduct<E>::Batch subgroup_batch(subgroup);
+    const std::vector<E> gens(group.generators_.begin(),
+                              group.generators_.end());
+
+    // Adds H * r, where r = parent * s.
+    std::vector<E> coset;
+    std::vector<E> parents;
+    std::vector<bool> is_new;
+    auto add_coset = [&](const E& r, const E& parent, const E& s) {
+      coset.clear();
+      subgroup_batch.RightMultiply(r, &coset);
+      for (const E& x: coset) {
+        if (!CheckElement(x, group.identity_)) return false;
+      }
+      if (tree != nullptr) {
+        // h * r = (h * parent) * s.
+        parents.clear();
+        subgroup_batch.RightMultiply(parent, &parents);
+        for (size_t i = 0; i < coset.size(); i++) {
+          tree->Add(coset[i], parents[i], s);
+        }
+      }
+      BatchInsert<Storage, E>::Insert(&group.elements_, coset, &is_new);
+      return true;
+    };
+
+    if (!add_coset(g, group.identity_, g)) return std::nullopt;
+    std::vector<E> representatives{g};
+    for (size_t i = 0; i < representatives.size(); i++) {
+      for (const E& s: gens) {
+        E r = representatives[i] * s;
+        if (group.elements_.contains(r)) continue;
+        if (!add_coset(r, representatives[i], s)) return std::nullopt;
+        representatives.push_back(std::move(r));
+      }
+    }
+    return group;
   }
 
   // Accessors.
-  const std::set<E>& elements() const { return elements_; }
+  const Storage& elements() const { return elements_; }
+  const std::set<E>& generators() const { return generators_; }
   const E& identity() const { return identity_; }
   bool is_abelian() const { return abelian_; }
 
-  // Cubic-time associativity test.
+  // The order of an element of the group, using |G| as a known multiple.
+  uint64_t Order(const E& e) const {
+    return ElementPowers<E>::Order(e, elements_.size());
+  }
+
+  // Light's associativity test: since every element is a product of
+  // generators, * is associative iff (x * g) * y == x * (g * y) for every
+  // generator g and all x and y. That's O(|G|^2 * |generators|) products
+  // rather than |G|^3. See associativity.h for parallel and sampling versions.
   bool TestAssociativity() const {
-    for (const E& a: elements_) {
-      for (const E& b: elements_) {
-	for (const E& c: elements_) {
-	  return (a * b) * c == a * (b * c);
-	}
+    for (const E& g: generators_) {
+      for (const E& x: elements_) {
+        const E xg = x * g;
+        for (const E& y: elements_) {
+          if ((xg * y) != x * (g * y)) return false;
+        }
       }
     }
+    return true;
   }
 
  private:
-  Group(const E& identity, const std::set<E>& elements, bool abelian)
-    : elements_(elements), identity_(identity), abelian_(abelian) {}
-  std::set<E> elements_;
+  friend class ParallelClosure<E>;
+  friend class MappedGroup<E>;
+  template <GroupElement... Es>
+  friend Group<Product<Es...>> DirectProduct(const Group<Es>&... factors);
+
+  Group(const E& identity, Storage elements, const std::set<E>& generators,
+        bool abelian)
+    : elements_(std::move(elements)), generators_(generators),
+      identity_(identity), abelian_(abelian) {}
+
+  static Storage ToStorage(std::set<E> elements) {
+    if constexpr (std::is_same_v<Storage, std::set<E>>) {
+      return elements;
+    } else {
+      Storage storage;
+      const std::vector<E> sorted(elements.begin(), elements.end());
+      std::vector<bool> is_new;
+      BatchInsert<Storage, E>::Insert(&storage, sorted, &is_new);
+      return storage;
+    }
+  }
+
+  // Copies the generators and their powers into elements, recording the
+  // edges child = parent * generator that were walked. This also provides some
+  // convenient checks and an opportunity to halt quickly if a group is larger
+  // than a certain size. Returns the identity, or std::nullopt if the cycles
+  // disagree about what it is.
+  static std::optional<E> GenerateCycles(
+      const std::set<E>& generators, std::set<E>* elements,
+      std::vector<std::pair<E, std::pair<E, E>>>* cycle_edges) {
+    std::optional<E> identity;
+    for(const E& g: generators) {
+      std::optional<E> prev;
+      for(E gn = g * g; gn != g; gn = g * gn) {
+        // Powers commute, so g * g^k == g^k * g is an edge from g^k.
+        cycle_edges->push_back({gn, {prev.value_or(g), g}});
+        prev = gn;
+        elements->insert(gn);
+      }
+      if (prev.has_value() && !identity.has_value()) {
+        identity = prev;
+      } else if (identity != prev) {
+        // If the identity is non-unique, the algorithm below may not work, so
+        // we quit while we're ahead.
+        return std::nullopt;
+      } else if (!prev.has_value()) {
+        // prev was unset because we saw the trivial group
+        if (generators.size() == 1) {
+          elements->insert(g);
+          return g;
+        }
+        return std::nullopt;
+      }
+      elements->insert(g);
+    }
+    return identity;
+  }
+
+  // For an associative operation, the group is abelian iff its generators
+  // commute with each other.
+  static bool GeneratorsCommute(const std::set<E>& generators) {
+    bool abelian = true;
+    for (const E& g: generators) {
+      for (const E& h: generators) {
+        if (h < g) continue;
+        abelian = abelian && g * h == h * g;
+      }
+    }
+    return abelian;
+  }
+
+  // The identity and inverse checks that every element must pass.
+  static bool CheckElement(const E& x, const E& identity) {
+    return x * (-x) == identity && x * identity == x && identity * x == x;
+  }
+
+  Storage elements_;
+  std::set<E> generators_;
   E identity_;
   bool abelian_;
 };
 
-// Print all groups of printable things.
-template <GroupElement E>
+// Print all groups of printable things. To print a group that is too big to
+// build, see element_stream.h.
+template <GroupElement E, ElementStorage<E> Storage>
 requires requires(E e, std::ostream o) { o << e; }
-std::ostream& operator<<(std::ostream& o, const Group<E>& g) {
+std::ostream& operator<<(std::ostream& o, const Group<E, Storage>& g) {
   if (g.is_abelian()) o << "abelian ";
   bool first = true;
   o << "{ ";
@@ -0,0 +1,341 @@
+#ifndef ALGEBRA_GROUP_CACHE_H_
+#define ALGEBRA_GROUP_CACHE_H_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <optional>
+#include <set>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+#include "cayley_table.h"
+#include "element_storage.h"
+#include "group.h"
+
+// An on-disk cache of finished groups, loaded with mmap.
+//
+// A file holds a group's sorted elements, its generators, the index of the
+// identity, the abelian flag and, optionally, its Cayley table, each section
+// aligned to 64 bytes after a fixed header. Loading maps the file and points
+// into it, so the cost is the page faults for whatever is actually read.
+//
+// Elements are stored as their bytes, so E must have a unique object
+// representation (trivially copyable and no padding): Permutation<N>, ModInt
+// and AbusePlusNotation<ModInt> all qualify. The file is only meaningful to the
+// same build on the same platform; the header records sizeof(E) and a hash of
+// typeid(E).name(), and files that don't match are rejected rather than
+// misread.
+//
+// GroupCache names files by a hash of the generator set, and checks the stored
+// generators against the requested ones on load.
+
+namespace groups {
+
+template <typename E>
+concept CacheableElement =
+    GroupElement<E> && std::has_unique_object_representations_v<E>;
+
+namespace cache_internal {
+
+constexpr char kMagic[8] = {'A', 'L', 'G', 'G', 'R', 'P', '\0', '\0'};
+constexpr uint32_t kVersion = 1;
+constexpr uint64_t kAlignment = 64;
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t element_size;
+  uint64_t element_type;
+  uint64_t generator_hash;
+  uint64_t element_count;
+  uint64_t generator_count;
+  uint64_t identity;
+  uint64_t abelian;
+  // 0 if there is no table. The table has element_count^2 uint32_t products
+  // (row-major) and then element_count uint32_t inverses.
+  uint64_t table_offset;
+  uint64_t elements_offset;
+  uint64_t generators_offset;
+  uint64_t file_size;
+};
+
+inline uint64_t Fnv1a(const void* data, size_t size,
+                      uint64_t hash = 14695981039346656037ull) {
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < size; i++) hash = (hash ^ bytes[i]) * 1099511628211ull;
+  return hash;
+}
+
+inline uint64_t AlignUp(uint64_t offset) {
+  return (offset + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+template <typename E>
+uint64_t ElementType() {
+  const char* name = typeid(E).name();
+  return Fnv1a(name, std::strlen(name));
+}
+
+} // namespace cache_internal
+
+// The content hash of a generator set, which is the cache key: the bytes of
+// the generators in order, and the element type.
+template <CacheableElement E>
+uint64_t GeneratorHash(const std::set<E>& generators) {
+  uint64_t hash = cache_internal::ElementType<E>();
+  for (const E& g: generators) hash = cache_internal::Fnv1a(&g, sizeof(E), hash);
+  return hash;
+}
+
+// A group loaded from a file, read in place from the mapping. Move-only; the
+// mapping is released when this is destroyed.
+template <GroupElement E>
+class MappedGroup {
+  static_assert(CacheableElement<E>,
+                "elements are read from the file as their bytes");
+
+ public:
+  // Maps the file at path. std::nullopt is returned if it can't be read or
+  // isn't a group of E in this format.
+  static std::optional<MappedGroup> Open(const std::string& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return std::nullopt;
+    struct stat st;
+    if (fstat(fd, &st) != 0 ||
+        static_cast<size_t>(st.st_size) < sizeof(cache_internal::Header)) {
+      close(fd);
+      return std::nullopt;
+    }
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return std::nullopt;
+    MappedGroup group(data, st.st_size);
+    if (!group.Valid()) return std::nullopt;
+    return group;
+  }
+
+  MappedGroup(MappedGroup&& other)
+    : data_(std::exchange(other.data_, nullptr)), size_(other.size_) {}
+  MappedGroup& operator=(MappedGroup&& other) {
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    return *this;
+  }
+  ~MappedGroup() {
+    if (data_ != nullptr) munmap(data_, size_);
+  }
+
+  // The elements in sorted order, as in Group::elements().
+  std::span<const E> elements() const {
+    return {Section<E>(header().elements_offset), header().element_count};
+  }
+  std::span<const E> generators() const {
+    return {Section<E>(header().generators_offset), header().generator_count};
+  }
+  const E& identity() const { return elements()[header().identity]; }
+  bool is_abelian() const { return header().abelian != 0; }
+  size_t size() const { return header().element_count; }
+
+  bool contains(const E& e) const { return IndexOf(e).has_value(); }
+  std::optional<size_t> IndexOf(const E& e) const {
+    const std::span<const E> els = elements();
+    auto it = std::lower_bound(els.begin(), els.end(), e);
+    if (it == els.end() || *it != e) return std::nullopt;
+    return it - els.begin();
+  }
+
+  // The Cayley table, by index into elements(), if one was stored.
+  bool has_table() const { return header().table_offset != 0; }
+  uint32_t Multiply(size_t a, size_t b) const {
+    return Section<uint32_t>(header().table_offset)[a * size() + b];
+  }
+  uint32_t Inverse(size_t a) const {
+    return Section<uint32_t>(header().table_offset)[size() * size() + a];
+  }
+
+  // Copies the elements out into a Group, for the algorithms that take one.
+  // No products are computed.
+  Group<E, FlatSet<E>> ToGroup() const {
+    FlatSet<E> storage;
+    std::vector<bool> is_new;
+    BatchInsert<FlatSet<E>, E>::Insert(&storage, elements(), &is_new);
+    const std::span<const E> gens = generators();
+    return Group<E, FlatSet<E>>(identity(), std::move(storage),
+                                std::set<E>(gens.begin(), gens.end()),
+                                is_abelian());
+  }
+
+ private:
+  MappedGroup(void* data, size_t size) : data_(data), size_(size) {}
+
+  const cache_internal::Header& header() const {
+    return *static_cast<const cache_internal::Header*>(data_);
+  }
+  template <typename T>
+  const T* Section(uint64_t offset) const {
+    return reinterpret_cast<const T*>(static_cast<const char*>(data_) + offset);
+  }
+
+  // Checks that the header describes this element type and that every
+  // section fits in the file.
+  bool Valid() const {
+    const cache_internal::Header& h = header();
+    if (std::memcmp(h.magic, cache_internal::kMagic, 8) != 0 ||
+        h.version != cache_internal::kVersion || h.element_size != sizeof(E) ||
+        h.element_type != cache_internal::ElementType<E>() ||
+        h.file_size != size_ || h.identity >= h.element_count) {
+      return false;
+    }
+    auto fits = [&](uint64_t offset, uint64_t count, uint64_t size) {
+      return offset % cache_internal::kAlignment == 0 && offset <= size_ &&
+             count <= (size_ - offset) / size;
+    };
+    if (!fits(h.elements_offset, h.element_count, sizeof(E)) ||
+        !fits(h.generators_offset, h.generator_count, sizeof(E))) {
+      return false;
+    }
+    if (h.table_offset != 0 &&
+        (h.element_count > UINT32_MAX ||
+         !fits(h.table_offset, h.element_count * (h.element_count + 1),
+               sizeof(uint32_t)))) {
+      return false;
+    }
+    const std::span<const E> gens = generators();
+    std::set<E> generator_set(gens.begin(), gens.end());
+    return GeneratorHash(generator_set) == h.generator_hash;
+  }
+
+  void* data_;
+  size_t size_;
+};
+
+// Writes the group (and its Cayley table, if given) to path. The file is
+// written next to path and renamed into place, so readers never see half of
+// it. Returns false on an I/O error.
+template <CacheableElement E, ElementStorage<E> Storage>
+bool SaveGroup(const Group<E, Storage>& group, const std::string& path,
+               const CayleyTable<E>* table = nullptr) {
+  using cache_internal::AlignUp;
+  const uint64_t n = group.elements().size();
+  cache_internal::Header h{};
+  std::memcpy(h.magic, cache_internal::kMagic, 8);
+  h.version = cache_internal::kVersion;
+  h.element_size = sizeof(E);
+  h.element_type = cache_internal::ElementType<E>();
+  h.generator_hash = GeneratorHash(group.generators());
+  h.element_count = n;
+  h.generator_count = group.generators().size();
+  h.abelian = group.is_abelian();
+  h.elements_offset = AlignUp(sizeof(h));
+  h.generators_offset = AlignUp(h.elements_offset + n * sizeof(E));
+  uint64_t end = h.generators_offset + h.generator_count * sizeof(E);
+  if (table != nullptr) {
+    h.table_offset = AlignUp(end);
+    end = h.table_offset + n * (n + 1) * sizeof(uint32_t);
+  }
+  h.file_size = end;
+
+  std::vector<E> elements(group.elements().begin(), group.elements().end());
+  h.identity = std::lower_bound(elements.begin(), elements.end(),
+                                group.identity()) - elements.begin();
+  const std::vector<E> generators(group.generators().begin(),
+                                  group.generators().end());
+
+  // Unique per process and per save, so that threads saving the same path
+  // don't write into each other's temp files.
+  static std::atomic<uint64_t> saves = 0;
+  const std::string temp = path + ".tmp" + std::to_string(getpid()) + "." +
+                           std::to_string(saves++);
+  std::FILE* f = std::fopen(temp.c_str(), "wb");
+  if (f == nullptr) return false;
+  uint64_t written = 0;
+  auto write = [&](uint64_t offset, const void* data, uint64_t size) {
+    static const char kZeros[cache_internal::kAlignment] = {};
+    std::fwrite(kZeros, 1, offset - written, f);
+    std::fwrite(data, 1, size, f);
+    written = offset + size;
+  };
+  write(0, &h, sizeof(h));
+  write(h.elements_offset, elements.data(), n * sizeof(E));
+  write(h.generators_offset, generators.data(), generators.size() * sizeof(E));
+  if (table != nullptr) {
+    std::vector<uint32_t> inverses(n);
+    for (uint64_t a = 0; a < n; a++) inverses[a] = table->Inverse(a);
+    write(h.table_offset, table->Row(0), n * n * sizeof(uint32_t));
+    write(h.table_offset + n * n * sizeof(uint32_t), inverses.data(),
+          n * sizeof(uint32_t));
+  }
+  const bool ok = std::ferror(f) == 0;
+  if (std::fclose(f) != 0 || !ok) {
+    std::remove(temp.c_str());
+    return false;
+  }
+  return std::rename(temp.c_str(), path.c_str()) == 0;
+}
+
+// Groups by generator set, one file each in a directory.
+class GroupCache {
+ public:
+  explicit GroupCache(std::string directory) : directory_(std::move(directory)) {}
+
+  template <CacheableElement E>
+  std::string PathFor(const std::set<E>& generators) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.group",
+                  static_cast<unsigned long long>(GeneratorHash(generators)));
+    return directory_ + "/" + name;
+  }
+
+  // The cached group for the generators, if there is one and its generators
+  // really are these.
+  template <CacheableElement E>
+  std::optional<MappedGroup<E>> Find(const std::set<E>& generators) const {
+    std::optional<MappedGroup<E>> group =
+        MappedGroup<E>::Open(PathFor(generators));
+    if (!group.has_value()) return std::nullopt;
+    const std::span<const E> stored = group->generators();
+    if (!std::equal(stored.begin(), stored.end(), generators.begin(),
+                    generators.end())) {
+      return std::nullopt;
+    }
+    return group;
+  }
+
+  // The cached group, or else the group computed with Group::Create, saved
+  // (with its Cayley table if with_table) and mapped. std::nullopt if
+  // Group::Create fails or the file can't be written.
+  template <CacheableElement E>
+  std::optional<MappedGroup<E>> FindOrCreate(const std::set<E>& generators,
+                                             bool with_table = false) const {
+    if (auto found = Find(generators); found.has_value()) return found;
+    std::optional<Group<E, FlatSet<E>>> group =
+        Group<E, FlatSet<E>>::Create(generators);
+    if (!group.has_value()) return std::nullopt;
+    std::optional<CayleyTable<E>> table;
+    if (with_table) table = CayleyTable<E>::Create(*group);
+    if (!SaveGroup(*group, PathFor(generators),
+                   table.has_value() ? &*table : nullptr)) {
+      return std::nullopt;
+    }
+    return Find(generators);
+  }
+
+ private:
+  std::string directory_;
+};
+
+} // namespace groups
+
+#endif
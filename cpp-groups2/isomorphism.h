@@ -0,0 +1,342 @@
+#ifndef ALGEBRA_ISOMORPHISM_H_
+#define ALGEBRA_ISOMORPHISM_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "conjugacy.h"
+#include "group.h"
+
+// Homomorphisms between groups, and testing groups for isomorphism.
+//
+// A homomorphism from G is determined by where it sends G's generators, and a
+// map of generators extends to one exactly when it respects every edge of the
+// Cayley graph: phi(x * g) = phi(x) * phi(g) for each element x and generator
+// g. ExtendHomomorphism walks those edges breadth-first from the identity,
+// which is |G| * |generators| products in the target group.
+//
+// FindIsomorphism first compares fingerprints: the order, the abelian flag, the
+// number of elements of each order, and the size and element order of each
+// conjugacy class. These take O(|G| * |generators|) products plus an order
+// computation per class, and tell most non-isomorphic groups apart. When they
+// match, it searches over images of G's generators only. An isomorphism sends
+// each generator to an element with the same class size and order, the first
+// generator can be taken to a fixed representative of its class (composing
+// with an inner automorphism moves it there), and products of pairs of
+// generators must match too. Each surviving choice is tried with the Cayley
+// graph walk, which stops at the first edge that doesn't hold.
+
+namespace groups {
+
+// Invariants of a group, equal for isomorphic groups.
+struct GroupFingerprint {
+  size_t order = 0;
+  bool abelian = false;
+  // The number of elements of each order.
+  std::map<uint64_t, size_t> element_orders;
+  // (size, element order) of each conjugacy class, sorted.
+  std::vector<std::pair<size_t, uint64_t>> classes;
+
+  bool operator==(const GroupFingerprint& other) const = default;
+};
+
+struct IsomorphismStats {
+  bool fingerprints_match = false;
+  // Partial assignments of generator images visited, and full ones tried
+  // against the Cayley graph.
+  size_t search_nodes = 0;
+  size_t extensions = 0;
+};
+
+// A homomorphism, as the image of every element of its domain.
+template <GroupElement E, GroupElement F>
+class Homomorphism {
+ public:
+  // The image of e, or std::nullopt if e isn't in the domain.
+  std::optional<F> operator()(const E& e) const {
+    auto it = std::lower_bound(domain_.begin(), domain_.end(), e);
+    if (it == domain_.end() || *it != e) return std::nullopt;
+    return images_[it - domain_.begin()];
+  }
+
+  // The domain's elements in order, and their images.
+  const std::vector<E>& domain() const { return domain_; }
+  const std::vector<F>& images() const { return images_; }
+
+  std::vector<E> Kernel() const {
+    std::vector<E> kernel;
+    for (size_t i = 0; i < domain_.size(); i++) {
+      if (images_[i] == images_[identity_]) kernel.push_back(domain_[i]);
+    }
+    return kernel;
+  }
+  std::set<F> Image() const {
+    return std::set<F>(images_.begin(), images_.end());
+  }
+  bool injective() const { return Kernel().size() == 1; }
+
+ private:
+  template <GroupElement E2, ElementStorage<E2> S, GroupElement F2,
+            ElementStorage<F2> T>
+  friend std::optional<Homomorphism<E2, F2>> ExtendHomomorphism(
+      const Group<E2, S>&, const Group<F2, T>&, const std::map<E2, F2>&);
+  template <GroupElement E2, ElementStorage<E2> S, GroupElement F2,
+            ElementStorage<F2> T>
+  friend std::optional<Homomorphism<E2, F2>> FindIsomorphism(
+      const Group<E2, S>&, const Group<F2, T>&, IsomorphismStats*);
+
+  Homomorphism(std::vector<E> domain, std::vector<F> images, size_t identity)
+    : domain_(std::move(domain)), images_(std::move(images)),
+      identity_(identity) {}
+
+  std::vector<E> domain_;
+  std::vector<F> images_;
+  size_t identity_;
+};
+
+namespace isomorphism_internal {
+
+constexpr uint32_t kUnset = UINT32_MAX;
+
+// A group's elements numbered in sorted order, with right multiplication by
+// each generator as columns of indices.
+template <GroupElement E>
+struct Indexed {
+  std::vector<E> elements;
+  std::vector<E> generators;
+  uint32_t identity;
+  // columns[i * size() + x] is the index of elements[x] * generators[i].
+  std::vector<uint32_t> columns;
+
+  size_t size() const { return elements.size(); }
+  std::optional<uint32_t> IndexOf(const E& e) const {
+    auto it = std::lower_bound(elements.begin(), elements.end(), e);
+    if (it == elements.end() || *it != e) return std::nullopt;
+    return it - elements.begin();
+  }
+};
+
+template <GroupElement E, ElementStorage<E> Storage>
+Indexed<E> Index(const Group<E, Storage>& group) {
+  Indexed<E> g;
+  g.elements.assign(group.elements().begin(), group.elements().end());
+  g.generators.assign(group.generators().begin(), group.generators().end());
+  g.identity = *g.IndexOf(group.identity());
+  const size_t n = g.size();
+  g.columns.resize(g.generators.size() * n);
+  for (size_t i = 0; i < g.generators.size(); i++) {
+    for (size_t x = 0; x < n; x++) {
+      g.columns[i * n + x] = *g.IndexOf(g.elements[x] * g.generators[i]);
+    }
+  }
+  return g;
+}
+
+// The fingerprint, and each element's (class size, order) and class.
+struct Invariants {
+  GroupFingerprint fingerprint;
+  std::vector<std::pair<size_t, uint64_t>> labels;
+  std::vector<size_t> classes;
+};
+
+template <GroupElement E>
+Invariants Classify(const Indexed<E>& g, bool abelian) {
+  const size_t n = g.size();
+  internal::DisjointSets sets(n);
+  for (size_t i = 0; i < g.generators.size(); i++) {
+    const E inverse = -g.generators[i];
+    for (size_t x = 0; x < n; x++) {
+      sets.Union(x, *g.IndexOf(inverse * g.elements[g.columns[i * n + x]]));
+    }
+  }
+  Invariants result;
+  result.fingerprint.order = n;
+  result.fingerprint.abelian = abelian;
+  result.labels.resize(n);
+  result.classes.resize(n);
+  // Order is constant on a class, so it's computed once per class.
+  std::map<size_t, uint64_t> class_orders;
+  for (size_t x = 0; x < n; x++) {
+    const size_t root = sets.Find(x);
+    auto [it, added] = class_orders.emplace(root, 0);
+    if (added) {
+      it->second = ElementPowers<E>::Order(g.elements[root], n);
+      result.fingerprint.classes.emplace_back(sets.SizeOf(root), it->second);
+    }
+    result.classes[x] = root;
+    result.labels[x] = {sets.SizeOf(root), it->second};
+    result.fingerprint.element_orders[it->second]++;
+  }
+  std::sort(result.fingerprint.classes.begin(),
+            result.fingerprint.classes.end());
+  return result;
+}
+
+// Extends the map of generators over the Cayley graph of g into h, filling in
+// image (indices into h). Returns false at the first edge that doesn't hold,
+// or, if injective, the first repeated image.
+template <GroupElement E, GroupElement F>
+bool Extend(const Indexed<E>& g, const Indexed<F>& h,
+            const std::vector<F>& generator_images, bool injective,
+            std::vector<uint32_t>* image) {
+  const size_t n = g.size();
+  image->assign(n, kUnset);
+  std::vector<bool> used(injective ? h.size() : 0, false);
+  (*image)[g.identity] = h.identity;
+  if (injective) used[h.identity] = true;
+  std::vector<uint32_t> queue{g.identity};
+  for (size_t q = 0; q < queue.size(); q++) {
+    const uint32_t x = queue[q];
+    const F& x_image = h.elements[(*image)[x]];
+    for (size_t i = 0; i < g.generators.size(); i++) {
+      const uint32_t y = g.columns[i * n + x];
+      const std::optional<uint32_t> v =
+          h.IndexOf(x_image * generator_images[i]);
+      if (!v.has_value()) return false;
+      if ((*image)[y] == kUnset) {
+        if (injective && used[*v]) return false;
+        if (injective) used[*v] = true;
+        (*image)[y] = *v;
+        queue.push_back(y);
+      } else if ((*image)[y] != *v) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+} // namespace isomorphism_internal
+
+template <GroupElement E, ElementStorage<E> Storage>
+GroupFingerprint Fingerprint(const Group<E, Storage>& group) {
+  return isomorphism_internal::Classify(isomorphism_internal::Index(group),
+                                        group.is_abelian())
+      .fingerprint;
+}
+
+// The homomorphism from g to h that sends each generator of g to its entry in
+// images, or std::nullopt if there isn't one: if a generator has no entry, an
+// image isn't in h, or the images don't respect g's relations. Entries for
+// elements other than generators are checked against the extension.
+template <GroupElement E, ElementStorage<E> S, GroupElement F,
+          ElementStorage<F> T>
+std::optional<Homomorphism<E, F>> ExtendHomomorphism(
+    const Group<E, S>& g, const Group<F, T>& h, const std::map<E, F>& images) {
+  using namespace isomorphism_internal;
+  const Indexed<E> indexed_g = Index(g);
+  Indexed<F> indexed_h;
+  indexed_h.elements.assign(h.elements().begin(), h.elements().end());
+  indexed_h.identity = *indexed_h.IndexOf(h.identity());
+  std::vector<F> generator_images;
+  for (const E& s: indexed_g.generators) {
+    auto it = images.find(s);
+    if (it == images.end()) return std::nullopt;
+    generator_images.push_back(it->second);
+  }
+  std::vector<uint32_t> image;
+  if (!Extend(indexed_g, indexed_h, generator_images, false, &image)) {
+    return std::nullopt;
+  }
+  std::vector<F> result(image.size(), h.identity());
+  for (size_t x = 0; x < image.size(); x++) {
+    result[x] = indexed_h.elements[image[x]];
+  }
+  for (const auto& [e, f]: images) {
+    const std::optional<uint32_t> x = indexed_g.IndexOf(e);
+    if (!x.has_value() || result[*x] != f) return std::nullopt;
+  }
+  return Homomorphism<E, F>(indexed_g.elements, std::move(result),
+                            indexed_g.identity);
+}
+
+// An isomorphism from g to h, or std::nullopt if they aren't isomorphic.
+template <GroupElement E, ElementStorage<E> S, GroupElement F,
+          ElementStorage<F> T>
+std::optional<Homomorphism<E, F>> FindIsomorphism(
+    const Group<E, S>& g, const Group<F, T>& h,
+    IsomorphismStats* stats = nullptr) {
+  using namespace isomorphism_internal;
+  IsomorphismStats unused;
+  if (stats == nullptr) stats = &unused;
+  *stats = IsomorphismStats();
+  if (g.elements().size() != h.elements().size() ||
+      g.is_abelian() != h.is_abelian()) {
+    return std::nullopt;
+  }
+  const Indexed<E> indexed_g = Index(g);
+  const Indexed<F> indexed_h = Index(h);
+  const Invariants g_invariants = Classify(indexed_g, g.is_abelian());
+  const Invariants h_invariants = Classify(indexed_h, h.is_abelian());
+  if (g_invariants.fingerprint != h_invariants.fingerprint) return std::nullopt;
+  stats->fingerprints_match = true;
+
+  // The candidate images of each generator.
+  const size_t k = indexed_g.generators.size();
+  std::vector<uint32_t> generators(k);
+  std::vector<std::vector<uint32_t>> candidates(k);
+  for (size_t i = 0; i < k; i++) {
+    generators[i] = *indexed_g.IndexOf(indexed_g.generators[i]);
+    for (uint32_t y = 0; y < indexed_h.size(); y++) {
+      if (h_invariants.labels[y] != g_invariants.labels[generators[i]]) {
+        continue;
+      }
+      // One per class for the first generator.
+      if (i == 0 && h_invariants.classes[y] != y) continue;
+      candidates[i].push_back(y);
+    }
+  }
+  // The labels of products of pairs of generators, which the images' products
+  // must share.
+  std::vector<std::pair<size_t, uint64_t>> pair_labels(k * k);
+  for (size_t i = 0; i < k; i++) {
+    for (size_t j = 0; j < i; j++) {
+      pair_labels[i * k + j] = g_invariants.labels[*indexed_g.IndexOf(
+          indexed_g.generators[j] * indexed_g.generators[i])];
+    }
+  }
+
+  std::vector<F> images;
+  std::vector<uint32_t> image;
+  auto search = [&](auto&& self, size_t i) -> bool {
+    stats->search_nodes++;
+    if (i == k) {
+      stats->extensions++;
+      return Extend(indexed_g, indexed_h, images, true, &image);
+    }
+    for (uint32_t y: candidates[i]) {
+      const F& candidate = indexed_h.elements[y];
+      bool consistent = true;
+      for (size_t j = 0; j < i && consistent; j++) {
+        consistent = h_invariants.labels[*indexed_h.IndexOf(
+            images[j] * candidate)] == pair_labels[i * k + j];
+      }
+      if (!consistent) continue;
+      images.push_back(candidate);
+      if (self(self, i + 1)) return true;
+      images.pop_back();
+    }
+    return false;
+  };
+  if (!search(search, 0)) return std::nullopt;
+  std::vector<F> result;
+  result.reserve(image.size());
+  for (uint32_t y: image) result.push_back(indexed_h.elements[y]);
+  return Homomorphism<E, F>(indexed_g.elements, std::move(result),
+                            indexed_g.identity);
+}
+
+template <GroupElement E, ElementStorage<E> S, GroupElement F,
+          ElementStorage<F> T>
+bool AreIsomorphic(const Group<E, S>& g, const Group<F, T>& h) {
+  return FindIsomorphism(g, h).has_value();
+}
+
+} // namespace groups
+
+#endif
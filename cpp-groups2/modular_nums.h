@@ -1,48 +1,190 @@
 #ifndef ALGEBRA_MODULAR_INTS_H_
 #define ALGEBRA_MODULAR_INTS_H_
 
+#include <compare>
+#include <functional>
 #include <ostream>
 #include <set>
 #include <concepts>
+#include <cstdint>
 
 #include "group.h"
 
 // Modular integer wrapper types.
-// Includes a type for reformulating additive notation for use in the Group
-// class.
+// Includes types for reformulating additive notation, and the group of units,
+// for use in the Group class.
 
 namespace groups {
 
+// Multiplication modulo a fixed m < 2^31 without a hardware divide.
+//
+// Barrett reduction: with im = ceil(2^64 / m), the quotient z / m is either
+// (z * im) >> 64 or one less, so z % m is one multiply-high, one multiply and a
+// correction. When m is a compile-time constant, im is one too.
+class BarrettReduction {
+ public:
+  constexpr explicit BarrettReduction(uint32_t m)
+    : m_(m), im_(~uint64_t{0} / m + 1) {}
+
+  // a * b % m for a, b < m.
+  constexpr uint32_t Multiply(uint32_t a, uint32_t b) const {
+    const uint64_t z = uint64_t{a} * b;
+    const uint64_t x =
+        static_cast<uint64_t>((static_cast<unsigned __int128>(z) * im_) >> 64);
+    uint32_t v = static_cast<uint32_t>(z - x * m_);
+    // If x overshot by one, v wrapped around to v + 2^32 - m.
+    if (m_ <= v) v += m_;
+    return v;
+  }
+
+  constexpr uint32_t modulus() const { return m_; }
+
+ private:
+  uint32_t m_;
+  uint64_t im_;
+};
+
+namespace modular_internal {
+
+// a + b mod m for a, b < m < 2^31. The sum can pass 2^31, so it's taken in
+// uint32_t, where it can't overflow; m is then subtracted if it fits, which
+// compiles to a compare and a conditional move rather than a branch.
+constexpr int AddMod(int a, int b, int m) {
+  const uint32_t s = static_cast<uint32_t>(a) + static_cast<uint32_t>(b);
+  const uint32_t um = static_cast<uint32_t>(m);
+  return static_cast<int>(s >= um ? s - um : s);
+}
+
+// -a mod m for 0 <= a < m, which is 0 rather than m for a == 0.
+constexpr int NegateMod(int a, int m) {
+  return (m - a) & -static_cast<int>(a != 0);
+}
+
+// Reduces any n into [0, m).
+constexpr int Reduce(long long n, int m) {
+  const int r = static_cast<int>(n % m);
+  return r + ((r >> 31) & m);
+}
+
+// The inverse of a mod m by the extended Euclidean algorithm. Only meaningful
+// if gcd(a, m) == 1.
+constexpr int InverseMod(int a, int m) {
+  int r0 = m, r1 = a, t0 = 0, t1 = 1;
+  while (r1 != 0) {
+    const int q = r0 / r1;
+    int tmp = r0 - q * r1;
+    r0 = r1;
+    r1 = tmp;
+    tmp = t0 - q * t1;
+    t0 = t1;
+    t1 = tmp;
+  }
+  return Reduce(t0, m);
+}
+
+} // namespace modular_internal
+
 // Ints mod Mod.
-// GroupElement.
+//
+// Values are kept reduced, so + is a conditional subtract and * is a Barrett
+// reduction: the only division is in the constructor from an arbitrary int.
+// With + and unary -, wrap it in AbusePlusNotation for the cyclic group; with *
+// and Inverse(), wrap it in Units for the group of units (Z/Mod)^*.
 template <int Mod>
+requires (Mod > 0)
 class ModInt {
  public:
   // We'll allow implicit conversion for elegance.
-  ModInt(int n) : value_(n % Mod) {}
+  ModInt(int n) : value_(modular_internal::Reduce(n, Mod)) {}
   ModInt<Mod> operator+(ModInt<Mod> m) const {
-    return ModInt(value_ + m.value_);
+    return Reduced(modular_internal::AddMod(value_, m.value_, Mod));
+  }
+  ModInt<Mod> operator*(ModInt<Mod> m) const {
+    return Reduced(kReduction.Multiply(value_, m.value_));
   }
 
-  // This is for the container in Group.
-  bool operator<(const ModInt<Mod>& other) const {
-    return value_ < other.value_;
+  // This is for the container in Group, and for Units, which needs all of the
+  // comparisons.
+  std::strong_ordering operator<=>(const ModInt<Mod>& other) const {
+    return value_ <=> other.value_;
   }
   bool operator==(const ModInt<Mod>& other) const {
     return value_ == other.value_;
   }
 
-  // Sticking to positive bc % operator might round the wrong way
-  // (I'm too lazy to check and this definition is also correct.)
-  ModInt<Mod> operator-() const { return Mod - value_; }
+  ModInt<Mod> operator-() const {
+    return Reduced(modular_internal::NegateMod(value_, Mod));
+  }
+
+  // The multiplicative inverse. Only meaningful if value() is coprime to Mod.
+  ModInt<Mod> Inverse() const {
+    return Reduced(modular_internal::InverseMod(value_, Mod));
+  }
 
   int value() const { return value_; }
 
  private:
+  static constexpr BarrettReduction kReduction{Mod};
+
+  struct AlreadyReduced {};
+  ModInt(int n, AlreadyReduced) : value_(n) {}
+  static ModInt<Mod> Reduced(int n) { return ModInt<Mod>(n, AlreadyReduced{}); }
+
   // Invariant: this will always be modulo Mod.
   int value_;
 };
 
+// Ints mod a modulus that is only known at runtime, for when the moduli come
+// from data and a ModInt<Mod> instantiation for each would be silly.
+//
+// Each value carries its modulus (and the Barrett constant for it), so this is
+// a GroupElement on its own without any shared context. Combining values with
+// different moduli is meaningless; they still order consistently (by modulus
+// first) so that they can share a container.
+class DynamicModInt {
+ public:
+  // The modulus should be in [1, 2^31).
+  DynamicModInt(long long n, int modulus)
+    : DynamicModInt(modular_internal::Reduce(n, modulus),
+                    BarrettReduction(modulus)) {}
+
+  DynamicModInt operator+(const DynamicModInt& m) const {
+    return With(modular_internal::AddMod(value_, m.value_, modulus()));
+  }
+  DynamicModInt operator*(const DynamicModInt& m) const {
+    return With(reduction_.Multiply(value_, m.value_));
+  }
+  DynamicModInt operator-() const {
+    return With(modular_internal::NegateMod(value_, modulus()));
+  }
+
+  // The multiplicative inverse. Only meaningful if value() is coprime to
+  // modulus().
+  DynamicModInt Inverse() const {
+    return With(modular_internal::InverseMod(value_, modulus()));
+  }
+
+  std::strong_ordering operator<=>(const DynamicModInt& other) const {
+    if (modulus() != other.modulus()) return modulus() <=> other.modulus();
+    return value_ <=> other.value_;
+  }
+  bool operator==(const DynamicModInt& other) const {
+    return value_ == other.value_ && modulus() == other.modulus();
+  }
+
+  int value() const { return value_; }
+  int modulus() const { return static_cast<int>(reduction_.modulus()); }
+
+ private:
+  DynamicModInt(int n, const BarrettReduction& reduction)
+    : value_(n), reduction_(reduction) {}
+  DynamicModInt With(int n) const { return DynamicModInt(n, reduction_); }
+
+  // Invariant: this will always be modulo modulus().
+  int value_;
+  BarrettReduction reduction_;
+};
+
 // A way to have abuse of notation for abelian things.
 // This is since Abelian groups mostly use `+` (which is also how people tend
 // to think about integers as groups). Anything you can wrap in this class
@@ -62,6 +204,9 @@ class AbusePlusNotation {
   }
   AbusePlusNotation operator-() const { return -victim_; }
 
+  // The wrapped element.
+  const Ab& value() const { return victim_; }
+
   // Ordering is needed for GroupElement.
   bool operator<(const AbusePlusNotation<Ab>& other) const { return victim_ < other.victim_; }
   bool operator==(const AbusePlusNotation<Ab>& other) const { return victim_ == other.victim_; }
@@ -75,14 +220,77 @@ class AbusePlusNotation {
   Ab victim_;
 };
 
+// The group of units of a ring, under multiplication.
+// The ring type needs * and an Inverse(). Only wrap units: for ModInt<n> that
+// means values coprime to n, so Units<ModInt<n>> elements form (Z/n)^*.
+template <typename R>
+requires requires(R r1, R r2) {
+  { r1 * r2 } -> std::convertible_to<R>;
+  { r1.Inverse() } -> std::convertible_to<R>;
+  requires std::totally_ordered<R>;
+}
+class Units {
+ public:
+  Units(R v) : value_(v) {}
+  Units<R> operator*(const Units<R>& u) const { return value_ * u.value_; }
+  Units<R> operator-() const { return value_.Inverse(); }
+
+  const R& value() const { return value_; }
+
+  bool operator<(const Units<R>& other) const { return value_ < other.value_; }
+  bool operator==(const Units<R>& other) const { return value_ == other.value_; }
+
+  friend std::ostream& operator<<(std::ostream& o, const Units<R>& u) {
+    o << u.value_;
+    return o;
+  }
+
+ private:
+  R value_;
+};
+
 template <int Mod>
 std::ostream& operator<<(std::ostream& o, const ModInt<Mod>& m) {
   o << m.value();
   return o;
 }
 
+inline std::ostream& operator<<(std::ostream& o, const DynamicModInt& m) {
+  o << m.value();
+  return o;
+}
+
 typedef Group<AbusePlusNotation<ModInt<2>>> Z2;
 
 } // namespace groups
 
+template <int Mod>
+struct std::hash<groups::ModInt<Mod>> {
+  size_t operator()(const groups::ModInt<Mod>& m) const {
+    return std::hash<int>{}(m.value());
+  }
+};
+
+template <>
+struct std::hash<groups::DynamicModInt> {
+  size_t operator()(const groups::DynamicModInt& m) const {
+    return std::hash<long long>{}(
+        (static_cast<long long>(m.modulus()) << 32) | m.value());
+  }
+};
+
+template <typename Ab>
+struct std::hash<groups::AbusePlusNotation<Ab>> {
+  size_t operator()(const groups::AbusePlusNotation<Ab>& a) const {
+    return std::hash<Ab>{}(a.value());
+  }
+};
+
+template <typename R>
+struct std::hash<groups::Units<R>> {
+  size_t operator()(const groups::Units<R>& u) const {
+    return std::hash<R>{}(u.value());
+  }
+};
+
 #endif
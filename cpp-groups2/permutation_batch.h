@@ -0,0 +1,139 @@
+#ifndef ALGEBRA_PERMUTATION_BATCH_H_
+#define ALGEBRA_PERMUTATION_BATCH_H_
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+#if defined(__SSSE3__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Many permutations of N things, stored column-major (structure of arrays).
+//
+// Row i holds the image of i under every permutation in the batch, one byte
+// each. Multiplying the whole batch by a fixed permutation p is then:
+// - on the right (x * p): row i of the result is row p(i) of the batch, so
+//   it's N contiguous copies;
+// - on the left (p * x): every byte b becomes p(b), a table lookup that is a
+//   byte shuffle (pshufb) for N <= 16 and a pair of vpshufb with AVX2 for
+//   N <= 32, 16 or 32 permutations at a time.
+// permutations.h includes this and uses it for BatchProduct<Permutation<N>>, so
+// Group<Permutation<N>>::Create multiplies its frontier this way; include
+// permutations.h rather than this header.
+
+namespace groups {
+
+template<size_t N>
+class Permutation;
+
+template<size_t N>
+requires (N <= 256)
+class PermutationBatch {
+ public:
+  PermutationBatch() : size_(0) {}
+
+  explicit PermutationBatch(std::span<const Permutation<N>> permutations)
+      : images_(N * permutations.size()), size_(permutations.size()) {
+    for (size_t k = 0; k < size_; k++) {
+      for (size_t i = 0; i < N; i++) {
+        images_[i * size_ + k] = permutations[k].dests_[i];
+      }
+    }
+  }
+
+  size_t size() const { return size_; }
+
+  // The images of point under every permutation.
+  const uint8_t* Row(size_t point) const { return &images_[point * size_]; }
+
+  // The kth permutation.
+  Permutation<N> Get(size_t k) const {
+    std::array<int, N> dests;
+    for (size_t i = 0; i < N; i++) dests[i] = images_[i * size_ + k];
+    return Permutation<N>(dests);
+  }
+
+  // Appends all of the permutations to out, in order.
+  void AppendTo(std::vector<Permutation<N>>* out) const {
+    size_t start = out->size();
+    std::array<int, N> identity;
+    for (size_t i = 0; i < N; i++) identity[i] = i;
+    out->resize(start + size_, Permutation<N>(identity));
+    Permutation<N>* dest = out->data() + start;
+    for (size_t i = 0; i < N; i++) {
+      const uint8_t* row = Row(i);
+      for (size_t k = 0; k < size_; k++) dest[k].dests_[i] = row[k];
+    }
+  }
+
+  // Every x in the batch replaced with x * p.
+  PermutationBatch RightMultiply(const Permutation<N>& p) const {
+    PermutationBatch result;
+    result.size_ = size_;
+    result.images_.resize(images_.size());
+    for (size_t i = 0; i < N; i++) {
+      std::memcpy(&result.images_[i * size_], Row(p.dests_[i]), size_);
+    }
+    return result;
+  }
+
+  // Every x in the batch replaced with p * x.
+  PermutationBatch LeftMultiply(const Permutation<N>& p) const {
+    PermutationBatch result;
+    result.size_ = size_;
+    result.images_.resize(images_.size());
+    // At least one AVX2 register wide, with the points past N fixed, so the
+    // vector loads below only read defined bytes.
+    alignas(32) std::array<uint8_t, std::max<size_t>(N, 32)> table;
+    for (size_t i = 0; i < table.size(); i++) {
+      table[i] = i < N ? p.dests_[i] : i;
+    }
+    const uint8_t* in = images_.data();
+    uint8_t* out = result.images_.data();
+    const size_t total = images_.size();
+    size_t done = 0;
+#if defined(__SSSE3__)
+    if constexpr (N <= 16) {
+      __m128i lookup = _mm_load_si128(reinterpret_cast<const __m128i*>(table.data()));
+      for (; done + 16 <= total; done += 16) {
+        __m128i bytes =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + done));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + done),
+                         _mm_shuffle_epi8(lookup, bytes));
+      }
+    }
+#endif
+#if defined(__AVX2__)
+    if constexpr (N > 16 && N <= 32) {
+      __m256i lookup =
+          _mm256_load_si256(reinterpret_cast<const __m256i*>(table.data()));
+      __m256i low = _mm256_permute2x128_si256(lookup, lookup, 0x00);
+      __m256i high = _mm256_permute2x128_si256(lookup, lookup, 0x11);
+      for (; done + 32 <= total; done += 32) {
+        __m256i bytes =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + done));
+        __m256i use_high = _mm256_cmpgt_epi8(bytes, _mm256_set1_epi8(15));
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i*>(out + done),
+            _mm256_blendv_epi8(_mm256_shuffle_epi8(low, bytes),
+                               _mm256_shuffle_epi8(high, bytes), use_high));
+      }
+    }
+#endif
+    for (; done < total; done++) out[done] = table[in[done]];
+    return result;
+  }
+
+ private:
+  // images_[i * size_ + k] is where the kth permutation sends i.
+  std::vector<uint8_t> images_;
+  size_t size_;
+};
+
+} // namespace groups
+
+#endif
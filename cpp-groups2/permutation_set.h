@@ -0,0 +1,128 @@
+#ifndef ALGEBRA_PERMUTATION_SET_H_
+#define ALGEBRA_PERMUTATION_SET_H_
+
+#include <bit>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include "group.h"
+#include "permutations.h"
+
+// A set of permutations stored as one bit per permutation of N things.
+//
+// std::set<Permutation<N>> spends a tree node (roughly 40 bytes) plus 4 * N
+// bytes on every element. Here every permutation has a fixed bit given by its
+// rank, so the set is N! / 8 bytes however full it is: about 450KB for any
+// subset of S_10. Membership is a single bit test.
+
+namespace groups {
+
+template <size_t N>
+requires (N <= 12)
+class PermutationSet {
+ public:
+  // The number of bits, N!.
+  static constexpr uint64_t kCapacity = [] {
+    uint64_t factorial = 1;
+    for (size_t i = 2; i <= N; i++) factorial *= i;
+    return factorial;
+  }();
+
+  PermutationSet() : words_((kCapacity + 63) / 64, 0), size_(0) {}
+
+  // The elements of a group.
+  template <ElementStorage<Permutation<N>> Storage>
+  explicit PermutationSet(const Group<Permutation<N>, Storage>& group)
+      : PermutationSet() {
+    for (const Permutation<N>& p: group.elements()) insert(p);
+  }
+
+  // Returns true if p was not already in the set.
+  bool insert(const Permutation<N>& p) {
+    uint64_t rank = p.Rank();
+    uint64_t& word = words_[rank / 64];
+    uint64_t bit = uint64_t{1} << (rank % 64);
+    if (word & bit) return false;
+    word |= bit;
+    size_++;
+    return true;
+  }
+
+  // Returns true if p was in the set.
+  bool erase(const Permutation<N>& p) {
+    uint64_t rank = p.Rank();
+    uint64_t& word = words_[rank / 64];
+    uint64_t bit = uint64_t{1} << (rank % 64);
+    if (!(word & bit)) return false;
+    word &= ~bit;
+    size_--;
+    return true;
+  }
+
+  bool contains(const Permutation<N>& p) const {
+    uint64_t rank = p.Rank();
+    return (words_[rank / 64] >> (rank % 64)) & 1;
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  // Bytes used by the bitmap.
+  size_t memory_footprint() const { return words_.size() * sizeof(uint64_t); }
+
+  // Iterates over the permutations in the set, in the order of operator<
+  // (since ranks follow that order), so output matches std::set.
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Permutation<N>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = Permutation<N>;
+
+    const_iterator() = default;
+    Permutation<N> operator*() const { return Permutation<N>::Unrank(rank_); }
+    const_iterator& operator++() {
+      rank_ = set_->NextRank(rank_ + 1);
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator old = *this;
+      ++*this;
+      return old;
+    }
+    bool operator==(const const_iterator& other) const {
+      return rank_ == other.rank_;
+    }
+
+   private:
+    friend class PermutationSet;
+    const_iterator(const PermutationSet* set, uint64_t rank)
+        : set_(set), rank_(rank) {}
+    const PermutationSet* set_ = nullptr;
+    uint64_t rank_ = kCapacity;
+  };
+
+  const_iterator begin() const { return const_iterator(this, NextRank(0)); }
+  const_iterator end() const { return const_iterator(this, kCapacity); }
+
+ private:
+  // The smallest rank at least from that is in the set, or kCapacity.
+  uint64_t NextRank(uint64_t from) const {
+    if (from >= kCapacity) return kCapacity;
+    size_t w = from / 64;
+    uint64_t word = words_[w] & (~uint64_t{0} << (from % 64));
+    while (word == 0) {
+      if (++w == words_.size()) return kCapacity;
+      word = words_[w];
+    }
+    return w * 64 + std::countr_zero(word);
+  }
+
+  std::vector<uint64_t> words_;
+  size_t size_;
+};
+
+} // namespace groups
+
+#endif
@@ -1,12 +1,19 @@
 #ifndef ALGEBRA_PERUMTATIONS_H_
 #define ALGEBRA_PERUMTATIONS_H_
 
+#include <algorithm>
 #include <array>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <numeric>
 #include <optional>
 #include <ostream>
 #include <set>
+#include <vector>
 
 #include "group.h"
+#include "permutation_batch.h"
 
 // Implementation of permutations.
 
@@ -80,6 +87,106 @@ class Permutation{
     return i < N && dests_[i] < other.dests_[i];
   }
 
+  // The identity permutation.
+  static Permutation<N> Identity() {
+    return Permutation<N>(std::array<int, 0>{});
+  }
+
+  // Where the permutation sends i.
+  int Image(size_t i) const { return dests_[i]; }
+
+  // The lengths of the cycles, longest first, including fixed points as
+  // cycles of length 1. Two permutations are conjugate in S_N iff they have
+  // the same cycle type.
+  std::vector<int> CycleType() const {
+    std::vector<int> lengths;
+    std::array<bool, N> seen{};
+    for (size_t i = 0; i < N; i++) {
+      if (seen[i]) continue;
+      int length = 0;
+      for (size_t j = i; !seen[j]; j = dests_[j]) {
+        seen[j] = true;
+        length++;
+      }
+      lengths.push_back(length);
+    }
+    std::sort(lengths.begin(), lengths.end(), std::greater<int>());
+    return lengths;
+  }
+
+  // The order, as the lcm of the cycle lengths. O(N).
+  uint64_t Order() const {
+    uint64_t order = 1;
+    std::array<bool, N> seen{};
+    for (size_t i = 0; i < N; i++) {
+      if (seen[i]) continue;
+      uint64_t length = 0;
+      for (size_t j = i; !seen[j]; j = dests_[j]) {
+        seen[j] = true;
+        length++;
+      }
+      order = std::lcm(order, length);
+    }
+    return order;
+  }
+
+  // The k-th power, by rotating each cycle k places rather than multiplying.
+  // Negative k are powers of the inverse. O(N).
+  Permutation<N> Pow(int64_t k) const {
+    std::array<int, N> new_dests;
+    std::array<bool, N> seen{};
+    std::array<int, N> cycle;
+    for (size_t i = 0; i < N; i++) {
+      if (seen[i]) continue;
+      int64_t length = 0;
+      for (size_t j = i; !seen[j]; j = dests_[j]) {
+        seen[j] = true;
+        cycle[length++] = j;
+      }
+      const int64_t shift = (k % length + length) % length;
+      for (int64_t c = 0; c < length; c++) {
+        new_dests[cycle[c]] = cycle[(c + shift) % length];
+      }
+    }
+    return Permutation<N>(new_dests);
+  }
+
+  // The position of the permutation among all N! permutations in the order
+  // of operator< (its Lehmer code read as a factorial-base number). This is the
+  // inverse of Unrank. O(N) word operations.
+  uint64_t Rank() const requires (N <= 20) {
+    uint64_t rank = 0;
+    uint32_t used = 0;
+    for (size_t i = 0; i < N; i++) {
+      // The digit is how many unused values are smaller than dests_[i].
+      uint32_t below = (uint32_t{1} << dests_[i]) - 1;
+      rank = rank * (N - i) + dests_[i] - std::popcount(used & below);
+      used |= uint32_t{1} << dests_[i];
+    }
+    return rank;
+  }
+
+  // The permutation with the given rank, which must be less than N!.
+  // This is the factorial-base decoding done by the Java Group.Symmetric, but
+  // most significant digit first so that ranks follow operator<.
+  static Permutation<N> Unrank(uint64_t rank) requires (N <= 20) {
+    std::array<int, N> digits;
+    for (size_t i = 1; i <= N; i++) {
+      digits[N - i] = rank % i;
+      rank /= i;
+    }
+    std::array<int, N> dests;
+    uint32_t unused = (uint32_t{1} << N) - 1;
+    for (size_t i = 0; i < N; i++) {
+      // Take the digits[i]-th lowest unused value.
+      uint32_t remaining = unused;
+      for (int skip = digits[i]; skip > 0; skip--) remaining &= remaining - 1;
+      dests[i] = std::countr_zero(remaining);
+      unused &= ~(uint32_t{1} << dests[i]);
+    }
+    return Permutation<N>(dests);
+  }
+
   // Get the generators for the permutation group on N elements.
   static std::set<Permutation<N>> GetGroupGenerators() {
     std::array<int, 2> two_cycle{1, 0};
@@ -104,6 +211,11 @@ class Permutation{
   const std::array<int, N> get_mapping() const { return dests_; }
   
  private:
+  // The batch builds permutations it knows are bijective.
+  template<size_t M>
+  requires (M <= 256)
+  friend class PermutationBatch;
+
   std::array<int, N> dests_;
   // Constructs from a shorter array, embedding a permutation of a smaller
   // set into the permutations of N things (by acting trivially on the rest of
@@ -121,6 +233,48 @@ class Permutation{
 
 };
 
+// Orders and powers from the cycles, without any products.
+template<size_t N>
+struct ElementPowers<Permutation<N>> {
+  static Permutation<N> Pow(const Permutation<N>& p, int64_t k) {
+    return p.Pow(k);
+  }
+  static uint64_t Order(const Permutation<N>& p) { return p.Order(); }
+  static uint64_t Order(const Permutation<N>& p, uint64_t) { return p.Order(); }
+};
+
+// Multiplies batches column-major with PermutationBatch. A batch is transposed
+// once, so it pays off when it's multiplied by several permutations, as a
+// layer of Group::Create is by each generator.
+template<size_t N>
+requires (N <= 256)
+struct BatchProduct<Permutation<N>> {
+  class Batch {
+   public:
+    explicit Batch(std::span<const Permutation<N>> xs) : batch_(xs) {}
+    void RightMultiply(const Permutation<N>& g,
+                       std::vector<Permutation<N>>* out) const {
+      batch_.RightMultiply(g).AppendTo(out);
+    }
+
+   private:
+    PermutationBatch<N> batch_;
+  };
+};
+
 } // namespace groups
 
+// Hashing, for the containers that need it (such as the parallel closure).
+template<size_t N>
+struct std::hash<groups::Permutation<N>> {
+  size_t operator()(const groups::Permutation<N>& p) const {
+    // FNV-1a over the images.
+    size_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < N; i++) {
+      hash = (hash ^ static_cast<size_t>(p.Image(i))) * 1099511628211ull;
+    }
+    return hash;
+  }
+};
+
 #endif
@@ -0,0 +1,304 @@
+#ifndef ALGEBRA_PRODUCT_H_
+#define ALGEBRA_PRODUCT_H_
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <set>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "cayley_table.h"
+#include "group.h"
+
+// Direct products of groups.
+//
+// Product<E1, E2, ...> is the element type: tuples of factor elements,
+// multiplied componentwise and ordered lexicographically. DirectProduct builds
+// Group<Product<...>> straight from the factor groups, since the elements of
+// a product are just every combination of factor elements, and
+// ProductCayleyTable does the same for their Cayley tables. Neither does any
+// closure search.
+
+namespace groups {
+
+namespace product_internal {
+
+// A permutation of the types sorted by decreasing alignment (stable, so equal
+// alignments stay in order). Laying members out in this order leaves padding
+// only at the end, which std::tuple<Es...> in declaration order doesn't.
+template <typename... Ts>
+constexpr std::array<size_t, sizeof...(Ts)> ByAlignment() {
+  constexpr size_t n = sizeof...(Ts);
+  constexpr std::array<size_t, n> alignments{alignof(Ts)...};
+  std::array<size_t, n> order{};
+  for (size_t i = 0; i < n; i++) order[i] = i;
+  for (size_t i = 1; i < n; i++) {
+    for (size_t j = i; j > 0 && alignments[order[j - 1]] < alignments[order[j]];
+         j--) {
+      std::swap(order[j - 1], order[j]);
+    }
+  }
+  return order;
+}
+
+template <typename Tuple, typename Order>
+struct Reordered;
+
+template <typename Tuple, size_t... Is>
+struct Reordered<Tuple, std::index_sequence<Is...>> {
+  using type = std::tuple<std::tuple_element_t<Is, Tuple>...>;
+};
+
+template <typename Tuple, auto kOrder, size_t... Is>
+constexpr auto AsSequence(std::index_sequence<Is...>) {
+  return std::index_sequence<kOrder[Is]...>{};
+}
+
+template <typename T>
+concept Printable = requires(T t, std::ostream o) { o << t; };
+
+} // namespace product_internal
+
+// An element of E1 x E2 x ...
+// GroupElement.
+template <GroupElement... Es>
+requires (sizeof...(Es) > 0)
+class Product {
+ public:
+  static constexpr size_t kFactors = sizeof...(Es);
+  using Factors = std::tuple<Es...>;
+  template <size_t I>
+  using Factor = std::tuple_element_t<I, Factors>;
+
+  Product(const Es&... es) : Product(std::index_sequence_for<Es...>{}, es...) {}
+
+  // The I-th component.
+  template <size_t I>
+  const Factor<I>& get() const {
+    return std::get<kSlot[I]>(storage_);
+  }
+
+  Product operator*(const Product& p) const {
+    return Combine(std::index_sequence_for<Es...>{},
+                   [](const auto& a, const auto& b) { return a * b; }, p);
+  }
+  Product operator-() const {
+    return Map(std::index_sequence_for<Es...>{},
+               [](const auto& a) { return -a; });
+  }
+
+  // Lexicographic, with the first factor most significant.
+  bool operator<(const Product& other) const {
+    return Less<0>(other);
+  }
+  bool operator==(const Product& other) const {
+    return storage_ == other.storage_;
+  }
+
+  friend std::ostream& operator<<(std::ostream& o, const Product& p)
+  requires (product_internal::Printable<Es> && ...) {
+    o << "(";
+    p.Print(o, std::index_sequence_for<Es...>{});
+    return o << ")";
+  }
+
+ private:
+  static constexpr std::array<size_t, kFactors> kOrder =
+      product_internal::ByAlignment<Es...>();
+  // kSlot[i] is where factor i is stored, the inverse of kOrder.
+  static constexpr std::array<size_t, kFactors> kSlot = [] {
+    std::array<size_t, kFactors> slot{};
+    for (size_t i = 0; i < kFactors; i++) slot[kOrder[i]] = i;
+    return slot;
+  }();
+  using Storage = typename product_internal::Reordered<
+      Factors, decltype(product_internal::AsSequence<Factors, kOrder>(
+                   std::make_index_sequence<kFactors>{}))>::type;
+
+  template <size_t... Is>
+  Product(std::index_sequence<Is...>, const Es&... es)
+    : storage_(std::get<kOrder[Is]>(std::forward_as_tuple(es...))...) {}
+
+  template <size_t... Is, typename F>
+  Product Map(std::index_sequence<Is...>, F f) const {
+    return Product(f(get<Is>())...);
+  }
+  template <size_t... Is, typename F>
+  Product Combine(std::index_sequence<Is...>, F f, const Product& p) const {
+    return Product(f(get<Is>(), p.get<Is>())...);
+  }
+
+  template <size_t I>
+  bool Less(const Product& other) const {
+    if constexpr (I == kFactors) {
+      return false;
+    } else {
+      if (get<I>() < other.get<I>()) return true;
+      if (other.get<I>() < get<I>()) return false;
+      return Less<I + 1>(other);
+    }
+  }
+
+  template <size_t... Is>
+  void Print(std::ostream& o, std::index_sequence<Is...>) const {
+    ((o << (Is == 0 ? "" : ", ") << get<Is>()), ...);
+  }
+
+  Storage storage_;
+};
+
+// The direct product of the factor groups. Its elements are every tuple of
+// factor elements, and these are already sorted when the factors' elements
+// are enumerated in nested loops, so filling the std::set is O(|G|) with
+// insertion hints. The generators are each factor's generators, padded out
+// with the other factors' identities.
+template <GroupElement... Es>
+Group<Product<Es...>> DirectProduct(const Group<Es>&... factors) {
+  using P = Product<Es...>;
+  const std::tuple<const Group<Es>&...> groups(factors...);
+  const P identity(factors.identity()...);
+
+  std::set<P> elements;
+  [&]<size_t... Is>(std::index_sequence<Is...>) {
+    std::tuple<const Es*...> current;
+    auto fill = [&](auto&& self, auto level) -> void {
+      constexpr size_t I = decltype(level)::value;
+      if constexpr (I == sizeof...(Es)) {
+        elements.emplace_hint(elements.end(), *std::get<Is>(current)...);
+      } else {
+        for (const auto& e: std::get<I>(groups).elements()) {
+          std::get<I>(current) = &e;
+          self(self, std::integral_constant<size_t, I + 1>{});
+        }
+      }
+    };
+    fill(fill, std::integral_constant<size_t, 0>{});
+  }(std::index_sequence_for<Es...>{});
+
+  std::set<P> generators;
+  [&]<size_t... Is>(std::index_sequence<Is...>) {
+    auto add = [&]<size_t I>(std::integral_constant<size_t, I>) {
+      for (const auto& g: std::get<I>(groups).generators()) {
+        auto component = [&]<size_t J>(
+            std::integral_constant<size_t, J>) -> const auto& {
+          if constexpr (I == J) {
+            return g;
+          } else {
+            return identity.template get<J>();
+          }
+        };
+        generators.insert(P(component(std::integral_constant<size_t, Is>{})...));
+      }
+    };
+    (add(std::integral_constant<size_t, Is>{}), ...);
+  }(std::index_sequence_for<Es...>{});
+
+  const bool abelian = (factors.is_abelian() && ...);
+  return Group<P>(identity, elements, generators, abelian);
+}
+
+// The Cayley table of a direct product, composed from the factors' tables.
+//
+// The product's elements are numbered in mixed radix with the first factor's
+// index most significant, which is also the order of DirectProduct's
+// elements, so these indices agree with CayleyTable on the product group.
+// Multiplying is a lookup in each factor's table: no |G|^2 table is built.
+// The factor tables are referenced, not copied, so they must outlive this.
+template <GroupElement... Es>
+class ProductCayleyTable {
+ public:
+  static constexpr size_t kFactors = sizeof...(Es);
+
+  explicit ProductCayleyTable(const CayleyTable<Es>&... tables)
+    : tables_(tables...) {
+    const std::array<size_t, kFactors> sizes{tables.size()...};
+    size_ = 1;
+    for (size_t i = kFactors; i-- > 0;) {
+      strides_[i] = size_;
+      size_ *= sizes[i];
+    }
+    identity_ = Compose([&](size_t i, const auto& t) {
+      return static_cast<size_t>(t.identity());
+    });
+  }
+
+  size_t size() const { return size_; }
+  size_t identity() const { return identity_; }
+
+  // The index of each factor's part of a.
+  std::array<size_t, kFactors> Split(size_t a) const {
+    std::array<size_t, kFactors> parts;
+    for (size_t i = 0; i < kFactors; i++) {
+      parts[i] = a / strides_[i];
+      a %= strides_[i];
+    }
+    return parts;
+  }
+
+  size_t Multiply(size_t a, size_t b) const {
+    const auto pa = Split(a), pb = Split(b);
+    return Compose([&](size_t i, const auto& t) {
+      return static_cast<size_t>(t.Multiply(pa[i], pb[i]));
+    });
+  }
+  size_t Inverse(size_t a) const {
+    const auto pa = Split(a);
+    return Compose([&](size_t i, const auto& t) {
+      return static_cast<size_t>(t.Inverse(pa[i]));
+    });
+  }
+
+  Product<Es...> Element(size_t a) const {
+    const auto pa = Split(a);
+    return [&]<size_t... Is>(std::index_sequence<Is...>) {
+      return Product<Es...>(std::get<Is>(tables_).Element(pa[Is])...);
+    }(std::index_sequence_for<Es...>{});
+  }
+  std::optional<size_t> IndexOf(const Product<Es...>& p) const {
+    std::optional<size_t> index = 0;
+    [&]<size_t... Is>(std::index_sequence<Is...>) {
+      auto add = [&](size_t i, auto part) {
+        if (!part.has_value() || !index.has_value()) {
+          index = std::nullopt;
+        } else {
+          *index += *part * strides_[i];
+        }
+      };
+      (add(Is, std::get<Is>(tables_).IndexOf(p.template get<Is>())), ...);
+    }(std::index_sequence_for<Es...>{});
+    return index;
+  }
+
+ private:
+  // Sums f(i, table i) * stride i over the factors.
+  template <typename F>
+  size_t Compose(F f) const {
+    return [&]<size_t... Is>(std::index_sequence<Is...>) {
+      return ((f(Is, std::get<Is>(tables_)) * strides_[Is]) + ...);
+    }(std::index_sequence_for<Es...>{});
+  }
+
+  std::tuple<const CayleyTable<Es>&...> tables_;
+  std::array<size_t, kFactors> strides_;
+  size_t size_;
+  size_t identity_;
+};
+
+} // namespace groups
+
+template <groups::GroupElement... Es>
+struct std::hash<groups::Product<Es...>> {
+  size_t operator()(const groups::Product<Es...>& p) const {
+    return [&]<size_t... Is>(std::index_sequence<Is...>) {
+      size_t h = 0;
+      ((h = h * 31 + std::hash<Es>{}(p.template get<Is>())), ...);
+      return h;
+    }(std::index_sequence_for<Es...>{});
+  }
+};
+
+#endif
@@ -0,0 +1,7 @@
+# Runs the benchmarks. Pass --json FILE to record results, or
+# --compare benchmark_baseline.json to check for regressions.
+g++ --std=c++2a -O3 benchmark.cpp -o benchmark
+./benchmark "$@"
+status=$?
+rm benchmark
+exit $status
@@ -0,0 +1,199 @@
+#ifndef ALGEBRA_SMALL_PERMUTATIONS_H_
+#define ALGEBRA_SMALL_PERMUTATIONS_H_
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <set>
+
+#if defined(__SSSE3__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "group.h"
+#include "permutations.h"
+
+// Permutations of at most 32 things, one byte per image.
+//
+// Composition f * g is the table lookup f[g[i]] for every i, which is exactly
+// what a byte shuffle does: pshufb (SSSE3) for N <= 16 and a pair of vpshufb
+// (AVX2) for N <= 32. Without those instruction sets, a scalar loop is used.
+// Compile with -mssse3, -mavx2 or -march=native to get the vector paths.
+//
+// The images past N are kept as the identity so that the whole vector can be
+// shuffled and compared without masking.
+
+namespace groups {
+
+template <size_t N>
+requires (N <= 32)
+class SmallPermutation {
+ public:
+  static constexpr size_t kWidth = N <= 16 ? 16 : 32;
+
+  explicit SmallPermutation(const Permutation<N>& p) {
+    for (size_t i = 0; i < kWidth; i++) {
+      dests_[i] = i < N ? p.Image(i) : i;
+    }
+  }
+
+  // Constructs from a mapping, ensuring bijectivity.
+  static std::optional<SmallPermutation> Create(
+      const std::array<int, N>& dests) {
+    std::optional<Permutation<N>> p = Permutation<N>::Create(dests);
+    if (!p.has_value()) return std::nullopt;
+    return SmallPermutation(*p);
+  }
+
+  static SmallPermutation Identity() {
+    return SmallPermutation(Permutation<N>::Identity());
+  }
+
+  // Invert a permutation. There is no shuffle for this, so it's scalar.
+  SmallPermutation<N> operator-() const {
+    SmallPermutation<N> inverse;
+    for (size_t i = 0; i < kWidth; i++) inverse.dests_[dests_[i]] = i;
+    return inverse;
+  }
+
+  // Compose permutations, with the same convention as Permutation<N>: f * g is
+  // "apply g and then f".
+  SmallPermutation<N> operator*(const SmallPermutation<N>& other) const {
+    SmallPermutation<N> product;
+#if defined(__SSSE3__)
+    if constexpr (kWidth == 16) {
+      __m128i table = _mm_load_si128(reinterpret_cast<const __m128i*>(dests_));
+      __m128i indices =
+          _mm_load_si128(reinterpret_cast<const __m128i*>(other.dests_));
+      _mm_store_si128(reinterpret_cast<__m128i*>(product.dests_),
+                      _mm_shuffle_epi8(table, indices));
+      return product;
+    }
+#endif
+#if defined(__AVX2__)
+    if constexpr (kWidth == 32) {
+      __m256i table =
+          _mm256_load_si256(reinterpret_cast<const __m256i*>(dests_));
+      __m256i indices =
+          _mm256_load_si256(reinterpret_cast<const __m256i*>(other.dests_));
+      // vpshufb only looks up within 128-bit lanes, so look up both halves of
+      // the table in both lanes and pick by whether the index is >= 16.
+      __m256i low = _mm256_permute2x128_si256(table, table, 0x00);
+      __m256i high = _mm256_permute2x128_si256(table, table, 0x11);
+      __m256i use_high = _mm256_cmpgt_epi8(indices, _mm256_set1_epi8(15));
+      _mm256_store_si256(
+          reinterpret_cast<__m256i*>(product.dests_),
+          _mm256_blendv_epi8(_mm256_shuffle_epi8(low, indices),
+                             _mm256_shuffle_epi8(high, indices), use_high));
+      return product;
+    }
+#endif
+    for (size_t i = 0; i < N; i++) {
+      product.dests_[i] = dests_[other.dests_[i]];
+    }
+    for (size_t i = N; i < kWidth; i++) product.dests_[i] = i;
+    return product;
+  }
+
+  // The same lexicographic order as Permutation<N>. Bytes compare unsigned, so
+  // memcmp already gives the right order; the vector versions find the first
+  // differing byte with a compare and a movemask.
+  bool operator==(const SmallPermutation<N>& other) const {
+#if defined(__SSSE3__)
+    if constexpr (kWidth == 16) return EqualMask(other) == 0xFFFF;
+#endif
+#if defined(__AVX2__)
+    if constexpr (kWidth == 32) return EqualMask(other) == 0xFFFFFFFF;
+#endif
+    return std::memcmp(dests_, other.dests_, kWidth) == 0;
+  }
+  bool operator<(const SmallPermutation<N>& other) const {
+#if defined(__SSSE3__)
+    if constexpr (kWidth == 16) return LessFromMask(other, EqualMask(other));
+#endif
+#if defined(__AVX2__)
+    if constexpr (kWidth == 32) return LessFromMask(other, EqualMask(other));
+#endif
+    return std::memcmp(dests_, other.dests_, kWidth) < 0;
+  }
+
+  int Image(size_t i) const { return dests_[i]; }
+
+  Permutation<N> ToPermutation() const {
+    std::array<int, N> dests;
+    for (size_t i = 0; i < N; i++) dests[i] = dests_[i];
+    return *Permutation<N>::Create(dests);
+  }
+
+  // Get the generators for the permutation group on N elements.
+  static std::set<SmallPermutation<N>> GetGroupGenerators() {
+    std::set<SmallPermutation<N>> generators;
+    for (const Permutation<N>& g: Permutation<N>::GetGroupGenerators()) {
+      generators.insert(SmallPermutation<N>(g));
+    }
+    return generators;
+  }
+
+  friend std::ostream& operator<<(std::ostream& o,
+                                  const SmallPermutation<N>& s) {
+    o << "[ ";
+    for(size_t i = 0; i < N; i++) {
+      if (i > 0) o << ", ";
+      o << static_cast<int>(s.dests_[i]);
+    }
+    o << "]";
+    return o;
+  }
+
+ private:
+  SmallPermutation() = default;
+
+#if defined(__SSSE3__) || defined(__AVX2__)
+  // Bit i is set when byte i of both permutations agrees.
+  uint32_t EqualMask(const SmallPermutation<N>& other) const {
+    if constexpr (kWidth == 16) {
+      __m128i a = _mm_load_si128(reinterpret_cast<const __m128i*>(dests_));
+      __m128i b =
+          _mm_load_si128(reinterpret_cast<const __m128i*>(other.dests_));
+      return _mm_movemask_epi8(_mm_cmpeq_epi8(a, b));
+    } else {
+#if defined(__AVX2__)
+      __m256i a = _mm256_load_si256(reinterpret_cast<const __m256i*>(dests_));
+      __m256i b =
+          _mm256_load_si256(reinterpret_cast<const __m256i*>(other.dests_));
+      return _mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b));
+#else
+      return 0;
+#endif
+    }
+  }
+
+  bool LessFromMask(const SmallPermutation<N>& other, uint32_t equal) const {
+    uint32_t differ = ~equal;
+    if constexpr (kWidth == 16) differ &= 0xFFFF;
+    if (differ == 0) return false;
+    size_t i = std::countr_zero(differ);
+    return dests_[i] < other.dests_[i];
+  }
+#endif
+
+  alignas(kWidth) uint8_t dests_[kWidth];
+};
+
+} // namespace groups
+
+template <size_t N>
+struct std::hash<groups::SmallPermutation<N>> {
+  size_t operator()(const groups::SmallPermutation<N>& p) const {
+    size_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < N; i++) {
+      hash = (hash ^ static_cast<size_t>(p.Image(i))) * 1099511628211ull;
+    }
+    return hash;
+  }
+};
+
+#endif
@@ -0,0 +1,200 @@
+#ifndef ALGEBRA_STABILIZER_CHAIN_H_
+#define ALGEBRA_STABILIZER_CHAIN_H_
+
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "permutations.h"
+
+// A base and strong generating set for permutation groups.
+//
+// Group<Permutation<N>> needs every element in memory, which stops being
+// possible somewhere around S_10. A stabilizer chain only keeps, for each base
+// point, the orbit of that point under the stabilizer of the earlier base
+// points along with a coset representative for each orbit point. That is
+// O(N^2) permutations at worst, however big the group.
+
+namespace groups {
+
+// The stabilizer chain G = G_0 >= G_1 >= ... >= G_k = 1 where G_i fixes the
+// first i base points. Built with the deterministic Schreier-Sims algorithm.
+template <size_t N>
+class StabilizerChain {
+ public:
+  // Builds the chain for the group generated by generators, for instance the
+  // result of Permutation<N>::GetGroupGenerators().
+  explicit StabilizerChain(const std::set<Permutation<N>>& generators) {
+    for (const Permutation<N>& g: generators) {
+      if (g == Permutation<N>::Identity()) continue;
+      if (!Sift(g, 0).has_value()) continue;
+      // Every generator goes in at the top level, but the top level needs a
+      // base point that one of them moves.
+      if (levels_.empty()) AddLevel(g);
+      levels_[0].generators.push_back(g);
+    }
+    if (levels_.empty()) return;
+    ComputeOrbit(0);
+    Complete();
+  }
+
+  // The order of the group, which is the product of the orbit sizes. This
+  // fits as long as N <= 20; use orbit_sizes() beyond that.
+  uint64_t order() const {
+    uint64_t order = 1;
+    for (const Level& level: levels_) order *= level.orbit.size();
+    return order;
+  }
+
+  // |G_i : G_(i+1)| for each level.
+  std::vector<size_t> orbit_sizes() const {
+    std::vector<size_t> sizes;
+    for (const Level& level: levels_) sizes.push_back(level.orbit.size());
+    return sizes;
+  }
+
+  std::vector<int> base() const {
+    std::vector<int> base;
+    for (const Level& level: levels_) base.push_back(level.base_point);
+    return base;
+  }
+
+  // The levels, and for each the orbit of its base point (in discovery order,
+  // starting with the base point) and the transversal element for each orbit
+  // point. Every element of G is uniquely transversal(0, b_0) * ... *
+  // transversal(k - 1, b_(k-1)) with b_i in orbit(i).
+  size_t depth() const { return levels_.size(); }
+  const std::vector<int>& orbit(size_t i) const { return levels_[i].orbit; }
+  const Permutation<N>& transversal(size_t i, int point) const {
+    return *levels_[i].transversal[point];
+  }
+
+  // The strong generators, which generate G_i when restricted to levels i and
+  // below. Without duplicates.
+  std::set<Permutation<N>> strong_generators() const {
+    std::set<Permutation<N>> generators;
+    for (const Level& level: levels_) {
+      generators.insert(level.generators.begin(), level.generators.end());
+    }
+    return generators;
+  }
+
+  // Membership by sifting: O(|base| * N).
+  bool Contains(const Permutation<N>& p) const {
+    return !Sift(p, 0).has_value();
+  }
+
+  // A uniformly random element, as a product of uniformly random coset
+  // representatives from each level.
+  template <typename URBG>
+  Permutation<N> Random(URBG& rng) const {
+    Permutation<N> result = Permutation<N>::Identity();
+    for (const Level& level: levels_) {
+      std::uniform_int_distribution<size_t> pick(0, level.orbit.size() - 1);
+      result = result * *level.transversal[level.orbit[pick(rng)]];
+    }
+    return result;
+  }
+
+ private:
+  struct Level {
+    int base_point;
+    std::vector<Permutation<N>> generators;
+    // The orbit of base_point under generators, in discovery order.
+    std::vector<int> orbit;
+    // transversal[b] sends base_point to b, for b in the orbit.
+    std::array<std::optional<Permutation<N>>, N> transversal;
+  };
+
+  // Adds a level whose base point is the first point moved by p.
+  void AddLevel(const Permutation<N>& p) {
+    size_t point = 0;
+    while (p.Image(point) == static_cast<int>(point)) point++;
+    levels_.push_back(Level{static_cast<int>(point), {}, {}, {}});
+  }
+
+  // Recomputes the orbit and transversal of a level from its generators.
+  void ComputeOrbit(size_t i) {
+    Level& level = levels_[i];
+    level.transversal.fill(std::nullopt);
+    level.orbit = {level.base_point};
+    level.transversal[level.base_point] = Permutation<N>::Identity();
+    for (size_t j = 0; j < level.orbit.size(); j++) {
+      int point = level.orbit[j];
+      for (const Permutation<N>& s: level.generators) {
+        int image = s.Image(point);
+        if (level.transversal[image].has_value()) continue;
+        level.transversal[image] = s * *level.transversal[point];
+        level.orbit.push_back(image);
+      }
+    }
+  }
+
+  // Strips p through the levels from start onwards. Returns std::nullopt if p
+  // sifts down to the identity, and otherwise the residue along with the level
+  // at which it fell out (levels_.size() if it passed every level).
+  std::optional<std::pair<Permutation<N>, size_t>> Sift(Permutation<N> p,
+                                                        size_t start) const {
+    size_t i = start;
+    for (; i < levels_.size(); i++) {
+      const Level& level = levels_[i];
+      const auto& u = level.transversal[p.Image(level.base_point)];
+      if (!u.has_value()) return std::make_pair(p, i);
+      p = -*u * p;
+    }
+    if (p == Permutation<N>::Identity()) return std::nullopt;
+    return std::make_pair(p, i);
+  }
+
+  // The Schreier-Sims loop: every Schreier generator of every level must sift
+  // through the levels below it. Whenever one doesn't, its residue becomes a
+  // new strong generator and the levels it affects are rechecked first.
+  void Complete() {
+    int i = static_cast<int>(levels_.size()) - 1;
+    while (i >= 0) {
+      std::optional<size_t> restart = CheckLevel(i);
+      if (restart.has_value()) {
+        i = static_cast<int>(*restart);
+      } else {
+        i--;
+      }
+    }
+  }
+
+  // Sifts the Schreier generators of level i. Returns the level to continue
+  // from if a new strong generator was needed.
+  std::optional<size_t> CheckLevel(size_t i) {
+    // The loops below can grow levels_, so no references are kept across
+    // iterations.
+    for (size_t b = 0; b < levels_[i].orbit.size(); b++) {
+      for (size_t s = 0; s < levels_[i].generators.size(); s++) {
+        const Level& level = levels_[i];
+        int point = level.orbit[b];
+        const Permutation<N>& gen = level.generators[s];
+        // u_(s(b))^-1 * s * u_b fixes the base point, so it belongs to the
+        // next level down.
+        Permutation<N> schreier = -*level.transversal[gen.Image(point)]
+            * gen * *level.transversal[point];
+        auto residue = Sift(schreier, i + 1);
+        if (!residue.has_value()) continue;
+        auto [h, j] = *residue;
+        if (j == levels_.size()) AddLevel(h);
+        for (size_t l = i + 1; l <= j; l++) {
+          levels_[l].generators.push_back(h);
+          ComputeOrbit(l);
+        }
+        return j;
+      }
+    }
+    return std::nullopt;
+  }
+
+  std::vector<Level> levels_;
+};
+
+} // namespace groups
+
+#endif
@@ -0,0 +1,143 @@
+#ifndef ALGEBRA_THREAD_POOL_H_
+#define ALGEBRA_THREAD_POOL_H_
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// A small work-stealing thread pool for the parallel algorithms.
+//
+// Work is handed out as index ranges. Each worker starts with its own deque of
+// ranges, takes from the back of it, and when it runs dry steals from the
+// front of the other workers' deques. That keeps workers busy when some ranges
+// are much more expensive than others (e.g. closure frontier elements that
+// mostly find new elements versus ones that only find old ones).
+
+namespace groups {
+
+class ThreadPool {
+ public:
+  // Starts num_threads workers, or one per hardware thread if it's 0.
+  explicit ThreadPool(size_t num_threads = 0) {
+    if (num_threads == 0) {
+      num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < num_threads; i++) {
+      queues_.push_back(std::make_unique<Queue>());
+    }
+    for (size_t i = 0; i < num_threads; i++) {
+      threads_.emplace_back([this, i] { WorkerLoop(i); });
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& t: threads_) t.join();
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  size_t size() const { return threads_.size(); }
+
+  // Calls body(begin, end, worker) over ranges covering [0, count), each at
+  // most grain long, and blocks until all of them are done. worker is in
+  // [0, size()) and no two calls with the same worker run at once, so it can
+  // index per-worker scratch space.
+  void ParallelFor(size_t count, size_t grain,
+                   const std::function<void(size_t, size_t, size_t)>& body) {
+    if (count == 0) return;
+    grain = std::max<size_t>(grain, 1);
+    // Deal the ranges out round-robin so that every worker starts with some.
+    size_t worker = 0;
+    for (size_t begin = 0; begin < count; begin += grain) {
+      Queue& queue = *queues_[worker];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      queue.ranges.emplace_back(begin, std::min(count, begin + grain));
+      worker = (worker + 1) % queues_.size();
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    body_ = &body;
+    busy_ = threads_.size();
+    generation_++;
+    wake_.notify_all();
+    done_.wait(lock, [this] { return busy_ == 0; });
+    body_ = nullptr;
+  }
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::pair<size_t, size_t>> ranges;
+  };
+
+  void WorkerLoop(size_t worker) {
+    size_t seen_generation = 0;
+    while (true) {
+      const std::function<void(size_t, size_t, size_t)>* body;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [&] {
+          return stopping_ || generation_ != seen_generation;
+        });
+        if (stopping_) return;
+        seen_generation = generation_;
+        body = body_;
+      }
+      std::pair<size_t, size_t> range;
+      while (Pop(worker, &range) || Steal(worker, &range)) {
+        (*body)(range.first, range.second, worker);
+      }
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--busy_ == 0) done_.notify_one();
+    }
+  }
+
+  bool Pop(size_t worker, std::pair<size_t, size_t>* range) {
+    Queue& queue = *queues_[worker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.ranges.empty()) return false;
+    *range = queue.ranges.back();
+    queue.ranges.pop_back();
+    return true;
+  }
+
+  bool Steal(size_t thief, std::pair<size_t, size_t>* range) {
+    for (size_t i = 1; i < queues_.size(); i++) {
+      Queue& queue = *queues_[(thief + i) % queues_.size()];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (queue.ranges.empty()) continue;
+      *range = queue.ranges.front();
+      queue.ranges.pop_front();
+      return true;
+    }
+    return false;
+  }
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> threads_;
+
+  // Guards everything below.
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  const std::function<void(size_t, size_t, size_t)>* body_ = nullptr;
+  size_t generation_ = 0;
+  size_t busy_ = 0;
+  bool stopping_ = false;
+};
+
+} // namespace groups
+
+#endif
@@ -1,8 +1,13 @@
 #ifndef ALGEBRA_GROUP_H_
 #define ALGEBRA_GROUP_H_
 
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <map>
 #include <memory>
 #include <optional>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -11,67 +16,339 @@
 namespace algebra {
 
 template <typename Element>
-virtual class Set{
-    virtual bool Contains(const Element& e) const = 0;
-    // returns nullopt_t to say that the set is "infinite"
-    virtual std::optional<std::vector<Element>> Enumerate() const = 0;
-}
+class Set{
+    public:
+        virtual ~Set() = default;
+        virtual bool Contains(const Element& e) const = 0;
+        // returns nullopt_t to say that the set is "infinite"
+        virtual std::optional<std::vector<Element>> Enumerate() const = 0;
+};
 
+template <typename Element>
 class Subgroup;
+template <typename Element>
 class GroupPredicate;
 
+// Groups of elements. Subgroup enumeration needs the elements to be ordered
+// (operator<) so that they can be numbered.
 template <typename Element>
-virtual class Group : public Set<Element>{
-    virtual Element Identity() const = 0;
-    virtual Element Multiply(const Element& e1, const Element& e2) const = 0;
-    virtual Element Invert(const Element& e) = 0;
-
-    // Tries to generate all the subgroups that satisfy a predicate. Returns true
-    // iff all subgroups were generated. The expectation is that the generated subgroups
-    // are moved out.
-    virtual bool GenerateSubgroups(GroupPredicate cond, std::vector<std::unique_ptr<Subgroup>>* output);
+class Group : public Set<Element>{
+    public:
+        virtual Element Identity() const = 0;
+        virtual Element Multiply(const Element& e1, const Element& e2) const = 0;
+        virtual Element Invert(const Element& e) const = 0;
+
+        // Tries to generate all the subgroups that satisfy a predicate. Returns true
+        // iff all subgroups were generated. The expectation is that the generated subgroups
+        // are moved out.
+        //
+        // The default works for any finite group (one that can be enumerated):
+        // it starts from the cyclic subgroups and takes joins with cyclic
+        // subgroups until nothing new turns up. Every subgroup is the join of
+        // the cyclic subgroups it contains, so this finds all of them, and each
+        // subgroup is only ever extended once since they are deduplicated by
+        // membership bitset. Conditions that can only get worse in bigger
+        // subgroups (an upper bound on the order, an element condition that
+        // every element must meet) prune whole branches, and an order that has
+        // to be divisible by something that doesn't divide |G| stops the search
+        // before it starts.
+        virtual bool GenerateSubgroups(const GroupPredicate<Element>& cond, std::vector<std::unique_ptr<Subgroup<Element>>>* output) const;
 };
 
 template <typename Element>
-virtual class Subgroup: public Group<Element> {
-    virtual const Group * GetParent() const = 0;
-    virtual bool Normal() const = 0;
-    virtual const Group * Quotient() const = 0;
-}
+class Subgroup: public Group<Element> {
+    public:
+        virtual const Group<Element> * GetParent() const = 0;
+        virtual bool Normal() const = 0;
+        virtual const Group<Element> * Quotient() const = 0;
+};
+
+// A subgroup of a finite group, as the sorted list of its elements. This is
+// what Group::GenerateSubgroups produces.
+template <typename Element>
+class FiniteSubgroup: public Subgroup<Element> {
+    public:
+        // elements must be sorted and closed under the parent's operations.
+        FiniteSubgroup(const Group<Element>* parent, std::vector<Element> elements)
+            : parent(parent), elements(std::move(elements)) {}
+
+        bool Contains(const Element& e) const override {
+            return std::binary_search(elements.begin(), elements.end(), e);
+        }
+        std::optional<std::vector<Element>> Enumerate() const override {
+            return elements;
+        }
+        Element Identity() const override { return parent->Identity(); }
+        Element Multiply(const Element& e1, const Element& e2) const override {
+            return parent->Multiply(e1, e2);
+        }
+        Element Invert(const Element& e) const override {
+            return parent->Invert(e);
+        }
+
+        const Group<Element> * GetParent() const override { return parent; }
+        bool Normal() const override {
+            std::optional<std::vector<Element>> all = parent->Enumerate();
+            for (const Element& g : *all) {
+                const Element g_inverse = parent->Invert(g);
+                for (const Element& h : elements) {
+                    if (!Contains(parent->Multiply(parent->Multiply(g, h), g_inverse))) return false;
+                }
+            }
+            return true;
+        }
+        // Quotients aren't built by the subgroup search.
+        const Group<Element> * Quotient() const override { return nullptr; }
+
+    private:
+        const Group<Element> * const parent;
+        const std::vector<Element> elements;
+};
 
 template <typename Element>
 class SetPredicate: public predicate::Predicate<Set<Element>>{
     public:
-        bool Validate(const Set<Element>& s) override {
-            return s.Contains(e);
+        bool Validate(const Set<Element>& s) const override {
+            return s.Contains(expected);
         }
 
         static SetPredicate<Element> Contains(const Element& e){
             return SetPredicate(e);
         }
     private:
+        explicit SetPredicate(const Element& e) : expected(e) {}
         Element expected;
 };
 
+// A condition on an element of a group.
 template <typename Element>
-class ElementPredicate: public predicate::Predicate<Element>{
-        bool Validate(const Set<Element>& s) override;
+class ElementPredicate {
+    public:
+        bool Validate(const Group<Element>& g, const Element& e) const {
+            return ValidateOrder(Order(g, e));
+        }
+        // The same, given the order of the element.
+        bool ValidateOrder(int order) const {
+            return !order_condition.has_value() || order_condition->Validate(order);
+        }
 
-        static ElementPredicate<Element> OrderWhich(predicate::NumericPredicate is);
-        static ElementPredicate<Element> Generates(predicate::NumericPredicate is);
+        static ElementPredicate<Element> OrderWhich(predicate::NumericPred is){
+            return ElementPredicate(is);
+        }
+        // Both conditions.
+        ElementPredicate<Element> And(const ElementPredicate<Element>& other) const {
+            ElementPredicate<Element> p = *this;
+            if (!p.order_condition.has_value()) {
+                p.order_condition = other.order_condition;
+            } else if (other.order_condition.has_value()) {
+                p.order_condition = *p.order_condition & *other.order_condition;
+            }
+            return p;
+        }
+
+        // The order of e in g, by walking its cycle.
+        static int Order(const Group<Element>& g, const Element& e) {
+            const Element identity = g.Identity();
+            int order = 1;
+            for (Element power = e; power != identity; power = g.Multiply(power, e)) order++;
+            return order;
+        }
     private:
-        std::optional<Group> generates;
-        std::optional<predicate::NumericPredicate> order_condition;
+        explicit ElementPredicate(predicate::NumericPred is) : order_condition(is) {}
+        std::optional<predicate::NumericPred> order_condition;
 };
 
+// A condition on a subgroup: on its order, and on every one of its
+// elements.
 template <typename Element>
-class GroupPredicate: public SetPredicate {
-        bool Validate(const Set<Element>& s) override;
+class GroupPredicate {
+    public:
+        GroupPredicate() = default;
+
+        static GroupPredicate<Element> OrderWhich(predicate::NumericPred is){
+            GroupPredicate<Element> p;
+            p.order_condition = is;
+            return p;
+        }
+        static GroupPredicate<Element> EveryElement(ElementPredicate<Element> is){
+            GroupPredicate<Element> p;
+            p.element = is;
+            return p;
+        }
+        // Both conditions.
+        GroupPredicate<Element> And(const GroupPredicate<Element>& other) const {
+            GroupPredicate<Element> p = *this;
+            if (!p.order_condition.has_value()) {
+                p.order_condition = other.order_condition;
+            } else if (other.order_condition.has_value()) {
+                p.order_condition = *p.order_condition & *other.order_condition;
+            }
+            if (!p.element.has_value()) {
+                p.element = other.element;
+            } else if (other.element.has_value()) {
+                p.element = p.element->And(*other.element);
+            }
+            return p;
+        }
+
+        bool Validate(const Group<Element>& g) const {
+            std::optional<std::vector<Element>> elements = g.Enumerate();
+            if (!elements.has_value()) return false;
+            std::vector<int> element_orders;
+            if (element.has_value()) {
+                for (const Element& e : *elements) element_orders.push_back(ElementPredicate<Element>::Order(g, e));
+            } else {
+                element_orders.resize(elements->size());
+            }
+            return ValidateOrders(element_orders);
+        }
+
+        // The same for a subgroup, given the order of each of its elements.
+        // The subgroup search computes those once per element of the parent
+        // rather than once per subgroup.
+        bool ValidateOrders(const std::vector<int>& element_orders) const {
+            if (order_condition.has_value() && !order_condition->Validate(element_orders.size())) return false;
+            return EveryOrderValid(element_orders);
+        }
+
+        // The parts of the predicate that also fail for every bigger subgroup,
+        // so that the subgroup search can stop extending a subgroup that
+        // fails them. Takes the order of each element of the subgroup.
+        bool CanGrowFrom(const std::vector<int>& element_orders) const {
+            if (order_condition.has_value()) {
+                std::optional<int> upper = order_condition->UpperBound();
+                if (upper.has_value() && static_cast<int>(element_orders.size()) > *upper) return false;
+            }
+            return EveryOrderValid(element_orders);
+        }
+
+        // Whether any subgroup of a group of this order can pass (by
+        // Lagrange, subgroup orders divide it).
+        bool PossibleIn(size_t group_order) const {
+            if (!order_condition.has_value()) return true;
+            int divisor = order_condition->DivisibleBy();
+            if (divisor != 0 && group_order % divisor != 0) return false;
+            std::optional<int> lower = order_condition->LowerBound();
+            return !lower.has_value() || static_cast<int>(group_order) >= *lower;
+        }
+
     private:
-        ElementPredicate<Element> element;
-        std::unique_pointer<GroupPredicate> has_subgroup;
+        bool EveryOrderValid(const std::vector<int>& element_orders) const {
+            if (!element.has_value()) return true;
+            return std::all_of(element_orders.begin(), element_orders.end(), [&](int order) {
+                return element->ValidateOrder(order);
+            });
+        }
+
+        std::optional<predicate::NumericPred> order_condition;
+        std::optional<ElementPredicate<Element>> element;
 };
 
+template <typename Element>
+bool Group<Element>::GenerateSubgroups(const GroupPredicate<Element>& cond, std::vector<std::unique_ptr<Subgroup<Element>>>* output) const {
+    std::optional<std::vector<Element>> maybe_elements = this->Enumerate();
+    if (!maybe_elements.has_value()) return false;
+    std::vector<Element> elements = std::move(*maybe_elements);
+    std::sort(elements.begin(), elements.end());
+    if (!cond.PossibleIn(elements.size())) return true;
+
+    // Subgroups are bitsets over the element indices.
+    typedef std::vector<uint64_t> Members;
+    const size_t n = elements.size();
+    const size_t words = (n + 63) / 64;
+    auto index_of = [&](const Element& e) {
+        return std::lower_bound(elements.begin(), elements.end(), e) - elements.begin();
+    };
+    auto has = [](const Members& m, size_t i) { return (m[i / 64] >> (i % 64)) & 1; };
+    auto list = [&](const Members& m) {
+        std::vector<Element> in;
+        for (size_t i = 0; i < n; i++) {
+            if (has(m, i)) in.push_back(elements[i]);
+        }
+        return in;
+    };
+    // The order of each element, filled in from its cyclic subgroup below.
+    std::vector<int> orders(n, 0);
+    auto orders_of = [&](const Members& m) {
+        std::vector<int> in;
+        for (size_t i = 0; i < n; i++) {
+            if (has(m, i)) in.push_back(orders[i]);
+        }
+        return in;
+    };
+
+    // The closure of a subgroup and one more element: a breadth-first search
+    // over right multiplication by the old generators and the new one.
+    struct Found {
+        Members members;
+        std::vector<size_t> generators;
+    };
+    auto join = [&](const Found& h, size_t x) {
+        Found j{h.members, h.generators};
+        j.generators.push_back(x);
+        std::vector<size_t> frontier;
+        for (size_t i = 0; i < n; i++) {
+            if (has(j.members, i)) frontier.push_back(i);
+        }
+        while (!frontier.empty()) {
+            std::vector<size_t> next;
+            for (size_t a : frontier) {
+                for (size_t g : j.generators) {
+                    size_t b = index_of(Multiply(elements[a], elements[g]));
+                    if (has(j.members, b)) continue;
+                    j.members[b / 64] |= uint64_t{1} << (b % 64);
+                    next.push_back(b);
+                }
+            }
+            frontier = std::move(next);
+        }
+        return j;
+    };
+
+    Found trivial{Members(words, 0), {}};
+    size_t identity = index_of(Identity());
+    trivial.members[identity / 64] |= uint64_t{1} << (identity % 64);
+
+    // Cyclic subgroups, one generator each. The order of x is the size of
+    // its cyclic subgroup, so every element's order is known before any
+    // subgroup is checked.
+    std::vector<Found> cyclic;
+    std::set<Members> seen{trivial.members};
+    for (size_t x = 0; x < n; x++) {
+        Found c = join(trivial, x);
+        for (uint64_t word : c.members) orders[x] += std::popcount(word);
+        if (seen.insert(c.members).second) cyclic.push_back(std::move(c));
+    }
+
+    // Breadth-first over the lattice: every subgroup found is joined with
+    // every cyclic subgroup it doesn't already contain. seen memoizes the
+    // results, so each subgroup is extended once, whichever join found it.
+    // A cyclic subgroup that can't grow into an acceptable subgroup can't be
+    // part of one either.
+    std::vector<size_t> cyclic_generators;
+    std::vector<Found> found{trivial};
+    for (Found& c : cyclic) {
+        if (!cond.CanGrowFrom(orders_of(c.members))) continue;
+        cyclic_generators.push_back(c.generators[0]);
+        found.push_back(std::move(c));
+    }
+    for (size_t i = 1; i < found.size(); i++) {
+        for (size_t x : cyclic_generators) {
+            if (has(found[i].members, x)) continue;
+            Found j = join(found[i], x);
+            if (!seen.insert(j.members).second) continue;
+            if (!cond.CanGrowFrom(orders_of(j.members))) continue;
+            found.push_back(std::move(j));
+        }
+    }
+
+    for (const Found& f : found) {
+        if (!cond.ValidateOrders(orders_of(f.members))) continue;
+        output->push_back(std::make_unique<FiniteSubgroup<Element>>(this, list(f.members)));
+    }
+    return true;
+}
+
 } // namespace algebra
 
 #endif
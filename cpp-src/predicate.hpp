@@ -1,64 +1,118 @@
 #ifndef ALGEBRE_PREDICATE_H_
 #define ALGEBRE_PREDICATE_H_
 
-#include <vector>
-#include <optional>
+#include <concepts>
 #include <functional>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "util/primality.hpp"
 
 namespace predicate{
 
-template <typename Structure>
-virtual class Predicate{
-    virtual bool Validate(const Structure&) = 0;
+template <typename S>
+class Predicate{
+    public:
+        typedef S Structure;
+        virtual ~Predicate() = default;
+        virtual bool Validate(const S&) const = 0;
 };
 
 template <typename Structure>
 class WrappedFunction: public Predicate<Structure> {
     public:
-        explicit WrappedFunction(std::function<const Structure&, bool> pred) : predicate(pred) {}
+        explicit WrappedFunction(std::function<bool(const Structure&)> pred) : predicate(pred) {}
 
-        bool Validate(const Structure& e) override {
+        bool Validate(const Structure& e) const final {
             return predicate(e);
         }
     private:
-        std::function<const Structure&, bool> predicate;
+        std::function<bool(const Structure&)> predicate;
 };
 
 /*
- * NOTE: the lambdas below seem to capture a copy of
- * the references' values (ie. a copy of the values
- * referred to), so lifetimes should not be a concern.
- *
- * This is an assumption I am unsure I've tested quite
- * enough.
+ * The combinators below keep copies of their operands in the
+ * object they return, with the operand types as template
+ * parameters. So p1 & p2 is an AndPredicate<Structure, P1, P2>:
+ * no allocation, no std::function, and (since the operands'
+ * Validate is final) calls the compiler can inline. Lifetimes
+ * are not a concern since nothing is referenced.
  */
 
-template <typename Structure>
-operator& WrappedFunction<Structure>(const Predicate<Structure>& p1, const Predicate<Structure>& p2){
-    return WrappedFunction([=](const Structure& s){
-        return p1.Validate(s) && p2.Validate(s);
-    });
+template <typename P>
+concept AnyPredicate = std::derived_from<P, Predicate<typename P::Structure>>;
+
+template <typename Structure, typename P1, typename P2>
+class AndPredicate: public Predicate<Structure> {
+    public:
+        AndPredicate(P1 p1, P2 p2) : p1(std::move(p1)), p2(std::move(p2)) {}
+        bool Validate(const Structure& s) const final {
+            return p1.P1::Validate(s) && p2.P2::Validate(s);
+        }
+    private:
+        P1 p1;
+        P2 p2;
+};
+
+template <typename Structure, typename P1, typename P2>
+class OrPredicate: public Predicate<Structure> {
+    public:
+        OrPredicate(P1 p1, P2 p2) : p1(std::move(p1)), p2(std::move(p2)) {}
+        bool Validate(const Structure& s) const final {
+            return p1.P1::Validate(s) || p2.P2::Validate(s);
+        }
+    private:
+        P1 p1;
+        P2 p2;
+};
+
+template <typename Structure, typename P1, typename P2>
+class XorPredicate: public Predicate<Structure> {
+    public:
+        XorPredicate(P1 p1, P2 p2) : p1(std::move(p1)), p2(std::move(p2)) {}
+        bool Validate(const Structure& s) const final {
+            return p1.P1::Validate(s) ^ p2.P2::Validate(s);
+        }
+    private:
+        P1 p1;
+        P2 p2;
+};
+
+template <typename Structure, typename P>
+class NotPredicate: public Predicate<Structure> {
+    public:
+        explicit NotPredicate(P p) : p(std::move(p)) {}
+        bool Validate(const Structure& s) const final {
+            return !p.P::Validate(s);
+        }
+    private:
+        P p;
+};
+
+template <AnyPredicate P1, AnyPredicate P2>
+requires std::same_as<typename P1::Structure, typename P2::Structure>
+AndPredicate<typename P1::Structure, P1, P2> operator&(const P1& p1, const P2& p2){
+    return {p1, p2};
 }
 
-template <typename Structure>
-operator| WrappedFunction<Structure>(const Predicate<Structure>& p1, const Predicate<Structure>& p2){
-    return WrappedFunction([=](const Structure& s){
-        return p1.Validate(s) || p2.Validate(s);
-    });
+template <AnyPredicate P1, AnyPredicate P2>
+requires std::same_as<typename P1::Structure, typename P2::Structure>
+OrPredicate<typename P1::Structure, P1, P2> operator|(const P1& p1, const P2& p2){
+    return {p1, p2};
 }
 
-template <typename Structure>
-operator^ WrappedFunction<Structure>(const Predicate<Structure>& p1, const Predicate<Structure>& p2){
-    return WrappedFunction([=](const Structure& s){
-        return p1.Validate(s) ^ p2.Validate(s);
-    });
+template <AnyPredicate P1, AnyPredicate P2>
+requires std::same_as<typename P1::Structure, typename P2::Structure>
+XorPredicate<typename P1::Structure, P1, P2> operator^(const P1& p1, const P2& p2){
+    return {p1, p2};
 }
 
-template <typename Structure>
-operator~ WrappedFunction<Structure>(const Predicate<Structure>& p1){
-    return WrappedFunction([=](const Structure& s){
-        return !p1.Validate(s);
-    });
+template <AnyPredicate P>
+NotPredicate<typename P::Structure, P> operator~(const P& p){
+    return NotPredicate<typename P::Structure, P>(p);
 }
 
 // A predicate on numbers, looking at comparisons, divisibility,
@@ -66,15 +120,62 @@ operator~ WrappedFunction<Structure>(const Predicate<Structure>& p1){
 // constructor, but the constructor is public for masochists.
 class NumericPred: public Predicate<int> {
     public:
-        bool Validate(const int& in){
+        NumericPred(int div_int, std::optional<int> upper_bound, std::optional<int> lower_bound, bool prime)
+            : div_int(div_int), upper_bound(upper_bound), lower_bound(lower_bound), prime(prime) {}
+
+        bool Validate(const int& in) const final {
             if(div_int != 0 && in % div_int != 0) return false;
             if(upper_bound.has_value() && in > upper_bound) return false;
             if(lower_bound.has_value() && in < lower_bound) return false;
             return !prime || CheckPrime(in);
         }
 
-    // TODO: custom (specialized?) overloads of the above &, |, ^, ~ to
-    // not bloat memory with wacky lambda thingies and just make the good validator.
+        // Validates a whole batch (say, the orders of every element of a
+        // group) in one loop. The bounds are hoisted out as plain ints so the
+        // common cases are a couple of compares per number.
+        std::vector<bool> Validate(std::span<const int> ins) const {
+            const int upper = upper_bound.value_or(std::numeric_limits<int>::max());
+            const int lower = lower_bound.value_or(std::numeric_limits<int>::min());
+            std::vector<bool> out(ins.size());
+            for(size_t i = 0; i < ins.size(); i++){
+                const int in = ins[i];
+                bool ok = in <= upper && in >= lower;
+                if(div_int != 0) ok = ok && in % div_int == 0;
+                out[i] = ok && (!prime || CheckPrime(in));
+            }
+            return out;
+        }
+
+        // The numbers in the batch that pass.
+        std::vector<int> Filter(std::span<const int> ins) const {
+            std::vector<bool> passed = Validate(ins);
+            std::vector<int> out;
+            for(size_t i = 0; i < ins.size(); i++){
+                if(passed[i]) out.push_back(ins[i]);
+            }
+            return out;
+        }
+
+        // A conjunction of numeric predicates is another numeric predicate:
+        // divisible by both divisors is divisible by their lcm, and the bounds
+        // intersect. So this & doesn't need to nest anything at all.
+        friend NumericPred operator&(const NumericPred& p1, const NumericPred& p2){
+            long long div = p1.div_int == 0 ? p2.div_int
+                : p2.div_int == 0 ? p1.div_int
+                : std::lcm<long long>(p1.div_int, p2.div_int);
+            std::optional<int> upper = p1.upper_bound;
+            if(!upper.has_value() || (p2.upper_bound.has_value() && *p2.upper_bound < *upper)) upper = p2.upper_bound;
+            std::optional<int> lower = p1.lower_bound;
+            if(!lower.has_value() || (p2.lower_bound.has_value() && *p2.lower_bound > *lower)) lower = p2.lower_bound;
+            if(div > std::numeric_limits<int>::max()){
+                // No int but 0 is a multiple of an lcm this big, so pin the
+                // bounds to 0 instead (nothing passes if they exclude it).
+                div = 0;
+                if(!upper.has_value() || *upper > 0) upper = 0;
+                if(!lower.has_value() || *lower < 0) lower = 0;
+            }
+            return NumericPred(static_cast<int>(div), upper, lower, p1.prime || p2.prime);
+        }
 
     // Factories! Make your numeric predicates in a lyrical English-sounding interface!
     static NumericPred IsNumber(int n){
@@ -82,31 +183,33 @@ class NumericPred: public Predicate<int> {
         return NumericPred(0, {n}, {n}, false);
     }
     static NumericPred IsAtLeast(int n){
-        return NumericPred(0, {std::nullopt_t}, {n}, false);
+        return NumericPred(0, std::nullopt, {n}, false);
     }
     static NumericPred IsAtMost(int n){
-        return NumericPred(0, {n}, {std::nullopt_t}, false);
+        return NumericPred(0, {n}, std::nullopt, false);
     }
     static NumericPred Divides(int n){
-        return NumericPred(n, {std::nullopt_t}, {std::nullopt_t}, false);
+        return NumericPred(n, std::nullopt, std::nullopt, false);
     }
     static NumericPred IsPrime(){
-        return NumericPred(0, {std::nullopt_t}, {std::nullopt_t}, true);
+        return NumericPred(0, std::nullopt, std::nullopt, true);
     }
 
+    // The bounds, for callers that can prune with them (e.g. subgroup
+    // searches, where an order above the upper bound stays above it).
+    std::optional<int> UpperBound() const { return upper_bound; }
+    std::optional<int> LowerBound() const { return lower_bound; }
+    int DivisibleBy() const { return div_int; }
+
     private:
-        // TODO: better ways to express stuff like "it's OK to Miller-Rabin"
-        // or something so that this isn't the trashiest. (Ooh, template param?)
-        bool CheckPrime(const int& in){
-            for(int i = 2; i < in; i++){ // Recall: loop won't run if in == 2
-                if(in % i == 0) return false;
-            }
-            return true;
+        // Constant-ish time; see util/primality.hpp.
+        bool CheckPrime(const int& in) const {
+            return in >= 2 && primality::IsPrime(in);
         }
 
         int div_int;
         std::optional<int> upper_bound, lower_bound;
-        bool prime
+        bool prime;
 };
 
 } // namespace predicate
@@ -0,0 +1,88 @@
+#include "test-util.hpp"
+#include "../group.hpp"
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+namespace {
+
+typedef std::array<int, 4> Perm;
+
+// S_4, as arrays of images.
+class SymmetricGroup4: public algebra::Group<Perm> {
+    public:
+        bool Contains(const Perm&) const override { return true; }
+        std::optional<std::vector<Perm>> Enumerate() const override {
+            std::vector<Perm> all;
+            Perm p = Identity();
+            do {
+                all.push_back(p);
+            } while (std::next_permutation(p.begin(), p.end()));
+            return all;
+        }
+        Perm Identity() const override {
+            Perm p;
+            std::iota(p.begin(), p.end(), 0);
+            return p;
+        }
+        Perm Multiply(const Perm& e1, const Perm& e2) const override {
+            Perm p;
+            for (int i = 0; i < 4; i++) p[i] = e2[e1[i]];
+            return p;
+        }
+        Perm Invert(const Perm& e) const override {
+            Perm p;
+            for (int i = 0; i < 4; i++) p[e[i]] = i;
+            return p;
+        }
+};
+
+std::vector<std::unique_ptr<algebra::Subgroup<Perm>>> Subgroups(const algebra::GroupPredicate<Perm>& cond) {
+    static const SymmetricGroup4 s4;
+    std::vector<std::unique_ptr<algebra::Subgroup<Perm>>> subgroups;
+    if (!s4.GenerateSubgroups(cond, &subgroups)) subgroups.clear();
+    return subgroups;
+}
+
+} // namespace
+
+MAKE_TEST(SubgroupsOfS4){
+    auto subgroups = Subgroups(algebra::GroupPredicate<Perm>());
+    size_t normal = std::count_if(subgroups.begin(), subgroups.end(), [](const auto& h) {
+        return h->Normal();
+    });
+    return subgroups.size() == 30 && normal == 4;
+}
+
+MAKE_TEST(SubgroupsOfS4ByOrder){
+    // Three cyclic and four Klein four-groups.
+    return Subgroups(algebra::GroupPredicate<Perm>::OrderWhich(predicate::NumericPred::IsNumber(4))).size() == 7
+        && Subgroups(algebra::GroupPredicate<Perm>::OrderWhich(predicate::NumericPred::IsAtMost(3))).size() == 14
+        && Subgroups(algebra::GroupPredicate<Perm>::OrderWhich(predicate::NumericPred::Divides(5))).empty();
+}
+
+MAKE_TEST(SubgroupsOfS4ByElementOrder){
+    // The trivial group, nine of order 2 and four Klein four-groups.
+    auto cond = algebra::GroupPredicate<Perm>::EveryElement(
+        algebra::ElementPredicate<Perm>::OrderWhich(predicate::NumericPred::IsAtMost(2)));
+    return Subgroups(cond).size() == 14;
+}
+
+MAKE_TEST(SubgroupsOfS4ByBothConditions){
+    typedef algebra::GroupPredicate<Perm> GP;
+    typedef algebra::ElementPredicate<Perm> EP;
+    // Nine subgroups of order 2 and four of order 3.
+    auto orders = GP::OrderWhich(predicate::NumericPred::IsAtLeast(2))
+        .And(GP::OrderWhich(predicate::NumericPred::IsAtMost(3)));
+    // Every element of order at most 2 (A_4 has elements of order 3).
+    auto elements = GP::EveryElement(EP::OrderWhich(predicate::NumericPred::IsAtMost(2))
+        .And(EP::OrderWhich(predicate::NumericPred::IsAtMost(3))));
+    auto both_sides = GP::EveryElement(EP::OrderWhich(predicate::NumericPred::IsAtMost(2)))
+        .And(GP::EveryElement(EP::OrderWhich(predicate::NumericPred::IsAtMost(3))));
+    return Subgroups(orders).size() == 13
+        && Subgroups(elements).size() == 14
+        && Subgroups(both_sides).size() == 14;
+}
@@ -0,0 +1,31 @@
+#include "test-util.hpp"
+#include "../predicate.hpp"
+
+#include <limits>
+#include <type_traits>
+
+using predicate::NumericPred;
+
+MAKE_TEST(NumericConjunctionIsFused){
+    auto p = NumericPred::IsAtLeast(3) & NumericPred::IsAtMost(20) & NumericPred::Divides(2) & NumericPred::Divides(3);
+    static_assert(std::is_same_v<decltype(p), NumericPred>);
+    return !p.Validate(2) && p.Validate(6) && p.Validate(18) && !p.Validate(24);
+}
+
+MAKE_TEST(NumericConjunctionOfLargeDivisors){
+    // The lcm of these is above INT_MAX, so only 0 is a multiple of it.
+    auto p = NumericPred::Divides(65537) & NumericPred::Divides(65539);
+    auto positive = p & NumericPred::IsAtLeast(1);
+    return p.Validate(0) && !p.Validate(65537) && !p.Validate(65539)
+        && !p.Validate(std::numeric_limits<int>::max()) && !positive.Validate(0);
+}
+
+MAKE_TEST(NumericCombinators){
+    auto p = (NumericPred::Divides(4) | NumericPred::IsNumber(7)) ^ ~NumericPred::IsAtMost(10);
+    return p.Validate(4) && p.Validate(7) && !p.Validate(12) && p.Validate(13) && !p.Validate(5);
+}
+
+MAKE_TEST(NumericBatchFilter){
+    std::vector<int> orders{1, 2, 3, 4, 6, 8, 12};
+    return NumericPred::Divides(2).Filter(orders) == std::vector<int>{2, 4, 6, 8, 12};
+}
@@ -0,0 +1,41 @@
+#include "test-util.hpp"
+#include "../predicate.hpp"
+#include "../util/primality.hpp"
+
+#include <cstdint>
+#include <vector>
+
+MAKE_TEST(SmallPrimesFromSieve){
+    return !primality::IsPrime(0) && !primality::IsPrime(1) && primality::IsPrime(2)
+        && primality::IsPrime(7919) && !primality::IsPrime(7917);
+}
+
+MAKE_TEST(MillerRabinPseudoprimes){
+    // Strong pseudoprimes to small bases, and the largest 64-bit prime.
+    return !primality::IsPrime(3215031751ull) && !primality::IsPrime(3825123056546413051ull)
+        && primality::IsPrime(18446744073709551557ull) && primality::IsPrime(2147483647);
+}
+
+MAKE_TEST(FactorizeAndSylow){
+    primality::Factorization expected{{2, 8}, {3, 4}, {5, 2}, {7, 1}};
+    return primality::Factorize(3628800) == expected
+        && primality::SylowOrder(3628800, 2) == 256
+        && primality::SylowOrder(3628800, 11) == 1;
+}
+
+MAKE_TEST(SieveAndMillerRabinAgree){
+    // Trial division around the point where lookups give way to Miller-Rabin.
+    for(uint64_t n = primality::kSieveLimit - 2000; n < primality::kSieveLimit + 2000; n++){
+        bool prime = n >= 2;
+        for(uint64_t d = 2; d * d <= n && prime; d++) prime = n % d != 0;
+        if(primality::IsPrime(n) != prime) return false;
+    }
+    return true;
+}
+
+MAKE_TEST(NumericPredIsPrime){
+    auto p = predicate::NumericPred::IsPrime();
+    return !p.Validate(-7) && !p.Validate(1) && p.Validate(2) && p.Validate(1048583)
+        && p.Validate(2147483647) && !p.Validate(2147483645)
+        && p.Filter(std::vector<int>{1, 2, 9, 11, 15, 17}) == std::vector<int>{2, 11, 17};
+}
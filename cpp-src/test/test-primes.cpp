@@ -1,6 +1,25 @@
 #include "test-util.hpp"
 #include "../util/compile-time-primes.hpp"
+#include "../util/primality.hpp"
 
 MAKE_TEST(PrimeTest){
     return Primes<0>::value == 2 && Primes<5>::value == 13;
 }
+
+MAKE_TEST(PrimeTableTest){
+    // Past the old template depth limit; 7919 is the last of the Java table.
+    return Primes<999>::value == 7919 && Primes<9999>::value == 104729
+        && kPrimeTable<1024>[1023] == 8161;
+}
+
+MAKE_TEST(PrimeTableMatchesSieve){
+    // Every prime in order, across many of the constexpr sieve's segments.
+    const auto& table = kPrimeTable<10240>;
+    size_t next = 0;
+    for(int n = 0; n <= table.back(); n++){
+        if(!primality::IsPrime(n)) continue;
+        if(next == table.size() || table[next] != n) return false;
+        next++;
+    }
+    return next == table.size();
+}
@@ -3,18 +3,32 @@
 #include <iostream>
 
 //static
-void TestCase::ExecuteTests(bool break_on_first){
-    for(const auto creator: tests){
-        std::unique_ptr<TestCase> test = std::move(creator());
+bool TestCase::ExecuteTests(bool break_on_first){
+    bool passed = true;
+    for(const auto& creator: Tests()){
+        std::unique_ptr<TestCase> test = creator();
         if(!(*test)()){
             std::cout << "Test " << test->ToString() << " failed!" << std::endl;
+            passed = false;
             if(break_on_first) break;
         }
     }
+    return passed;
 }
 
 //protected static
 bool TestCase::Register(TestCase::Creator c){
-    tests.push_back(c);
+    Tests().push_back(c);
     return true;
 }
+
+//private static
+std::vector<TestCase::Creator>& TestCase::Tests(){
+    static std::vector<Creator> tests;
+    return tests;
+}
+
+// Any argument stops at the first failure.
+int main(int argc, char** argv){
+    return TestCase::ExecuteTests(argc > 1) ? 0 : 1;
+}
@@ -11,23 +11,27 @@ struct TestCase {
     virtual bool operator()() = 0;
     virtual std::string ToString() = 0;
 
-    static void ExecuteTests(bool break_on_first);
+    // Runs the registered tests, printing the ones that fail. Returns true iff
+    // every test that ran passed.
+    static bool ExecuteTests(bool break_on_first);
 
     protected:
         static bool Register(Creator c);
 
     private:
-        static std::vector<Creator> tests;
+        // A function-local static, so that tests registered from other
+        // translation units never see it before it is constructed.
+        static std::vector<Creator>& Tests();
 };
 
 #define MAKE_TEST(name)\
     struct name: public TestCase{\
         bool operator()() override;\
-        std::string ToString(){ return #name;}\
-        static const TestCase::Creator maker = [](){\
+        std::string ToString() override { return #name;}\
+        static inline const TestCase::Creator maker = [](){\
             return std::make_unique<name>();\
         };\
-        static const bool registered = TestCase::Register(maker);\
+        static inline const bool registered = TestCase::Register(maker);\
     };\
     bool name::operator()()
 
@@ -1,68 +1,66 @@
 #ifndef ALGEBRA_UTIL_COMPILE_TIME_PRIMES_H_
 #define ALGEBRA_UTIL_COMPILE_TIME_PRIMES_H_
 
+#include <array>
+
 // A compile-time sieve implementation of the list of primes.
 // Prime<N>::value is the Nth prime with Prime<0>::value as 2.
-// Constructs N * Primes<N>::value
-
-// Forward-declaration of primes since the sieve needs it.
-template <int N>
-struct Primes;
-
-namespace {
-
-    // Check if K is not divisible by all primes up to and including the
-    // Nth one.
-    template<int N, int K>
-    struct Check{
-        static constexpr bool value = (K % Primes<N>::value != 0) && Check<N - 1, K>::value;
-    };
-
-    // Base case: odd K are not divisible by the 0th prime (2).
-    template<int K>
-    struct Check<0, K>{
-        static constexpr bool value = (K % 2 != 0);
-    };
+//
+// This used to be a recursive template search (one instantiation per number
+// tried), which ran into the template depth limit after a few hundred primes.
+// Now the table comes from a constexpr segmented sieve, so it's a loop for the
+// compiler to evaluate rather than a pile of types, and tens of thousands of
+// primes are fine.
 
-    // An upwards loop to the next prime. N is the number of primes known
-    // so that K can be correctly checked for primality. Stop informs the
-    // compiler when a check has passed and K is the next prime.
-    template<int N, int K, bool Stop>
-    struct Extend{
-        // constexpr need to be initialized, but this template is
-        // specialized exhaustively (for Stop being true or false),
-        // so you'll never get this "-1"
-        static constexpr int value = -1;
-    };
-
-    // If the check has passed, that is K is not divisible by any of the
-    // first N primes, the extension of our list of primes is value K (the
-    // N + 1st prime). (This is the base case.)
-    template<int N, int K>
-    struct Extend<N, K, true>{
-        static constexpr int value = K;
-    };
+// The first Count primes.
+//
+// The sieve runs over segments of kSegment odd numbers. At the start of a
+// segment the multiples of every prime found so far are crossed off; then the
+// segment is scanned upwards, and each number still standing is a new prime
+// whose multiples in the rest of the segment are crossed off too. So the sieve
+// never needs to know how far it has to go. Even numbers are skipped (bit i
+// is low + 2i) to halve the work, which matters since the compiler counts
+// every operation against -fconstexpr-ops-limit.
+template <int Count>
+constexpr std::array<int, Count> FirstPrimes(){
+    constexpr int kSegment = 1 << 13;
+    std::array<int, Count> primes{};
+    if(Count == 0) return primes;
+    primes[0] = 2;
+    int found = 1;
+    bool composite[kSegment] = {};
+    for(int low = 3; found < Count; low += 2 * kSegment){
+        const int high = low + 2 * kSegment;
+        for(int i = 0; i < kSegment; i++) composite[i] = false;
+        for(int j = 1; j < found && primes[j] <= (high - 1) / primes[j]; j++){
+            const int p = primes[j];
+            int m = (low + p - 1) / p * p;
+            if(m < p * p) m = p * p;
+            if(m % 2 == 0) m += p;
+            for(; m < high; m += 2 * p) composite[(m - low) / 2] = true;
+        }
+        for(int i = 0; i < kSegment && found < Count; i++){
+            if(composite[i]) continue;
+            const int n = low + 2 * i;
+            primes[found++] = n;
+            if(n > (high - 1) / n) continue;
+            for(int m = n * n; m < high; m += 2 * n) composite[(m - low) / 2] = true;
+        }
+    }
+    return primes;
+}
 
-    // If the check failed, K is divisible by one of the first N primes, so
-    // we check K + 1 (producing another Extend type to test that).
-    template<int N, int K>
-    struct Extend<N, K, false>{
-        static constexpr int value = Extend<N, K + 1, Check<N, K + 1>::value>::value;
-    };
+// Tables are built in blocks of kPrimeBlock so that nearby Primes<N> share
+// one table instead of each sieving their own.
+constexpr int kPrimeBlock = 1024;
 
-}
+template <int Count>
+inline constexpr std::array<int, Count> kPrimeTable = FirstPrimes<Count>();
 
-// Initialize the search for the Nth prime by extending from the list of
-// N-1 primes.
+// The Nth prime is a lookup in the smallest block-sized table that has it.
 template<int N>
 struct Primes{
-    static constexpr int value = Extend<N-1, Primes<N - 1>::value + 1, Check<N-1, Primes<N - 1>::value + 1>::value>::value;
-};
-
-// The 0th prime is 2. This is the base case.
-template<>
-struct Primes<0>{
-    static constexpr int value = 2;
+    static constexpr int value = kPrimeTable<(N / kPrimeBlock + 1) * kPrimeBlock>[N];
 };
 
 #endif
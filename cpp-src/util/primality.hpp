@@ -0,0 +1,199 @@
+#ifndef ALGEBRA_UTIL_PRIMALITY_H_
+#define ALGEBRA_UTIL_PRIMALITY_H_
+
+// Run-time primality and factorization.
+//
+// Small numbers (below kSieveLimit) are a bit lookup in a sieve that is built
+// once. Anything bigger gets a few trial divisions and then Miller-Rabin with
+// bases that are known to make it deterministic: {2, 7, 61} below 2^32, and
+// the first twelve primes for the rest of the 64-bit range. Either way a call
+// costs a bounded number of multiplications, not O(n) divisions.
+//
+// Factorizations (for divisibility and Sylow-type questions) are trial
+// division by the sieved primes plus Pollard's rho for what's left, and are
+// cached per thread since the same group orders come up over and over.
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace primality{
+
+constexpr uint32_t kSieveLimit = 1 << 20;
+
+namespace internal{
+
+    // Odd numbers only: bit i is 2i + 1.
+    class Sieve{
+        public:
+            Sieve() : composite(kSieveLimit / 2, false) {
+                composite[0] = true; // 1
+                for(uint32_t p = 3; p * p < kSieveLimit; p += 2){
+                    if(composite[p / 2]) continue;
+                    for(uint32_t m = p * p; m < kSieveLimit; m += 2 * p){
+                        composite[m / 2] = true;
+                    }
+                }
+                primes.push_back(2);
+                for(uint32_t i = 1; i < kSieveLimit / 2; i++){
+                    if(!composite[i]) primes.push_back(2 * i + 1);
+                }
+            }
+
+            bool IsPrime(uint32_t n) const {
+                if(n % 2 == 0) return n == 2;
+                return !composite[n / 2];
+            }
+
+            std::vector<bool> composite;
+            std::vector<uint32_t> primes;
+    };
+
+    inline const Sieve& GetSieve(){
+        static const Sieve sieve;
+        return sieve;
+    }
+
+    inline uint64_t MulMod(uint64_t a, uint64_t b, uint64_t m){
+        return static_cast<unsigned __int128>(a) * b % m;
+    }
+
+    inline uint64_t PowMod(uint64_t base, uint64_t exp, uint64_t m){
+        uint64_t result = 1;
+        base %= m;
+        for(; exp > 0; exp >>= 1){
+            if(exp & 1) result = MulMod(result, base, m);
+            base = MulMod(base, base, m);
+        }
+        return result;
+    }
+
+    // One round of Miller-Rabin for odd n > 2 where n - 1 = d * 2^s.
+    inline bool PassesRound(uint64_t n, uint64_t d, int s, uint64_t a){
+        uint64_t x = PowMod(a, d, n);
+        if(x == 1 || x == n - 1) return true;
+        for(int r = 1; r < s; r++){
+            x = MulMod(x, x, n);
+            if(x == n - 1) return true;
+        }
+        return false;
+    }
+
+    // A nontrivial factor of the odd composite n (Pollard's rho with Brent's
+    // cycle finding and batched gcds).
+    inline uint64_t FindFactor(uint64_t n){
+        for(uint64_t c = 1;; c++){
+            auto f = [&](uint64_t x){ return (MulMod(x, x, n) + c) % n; };
+            uint64_t y = 2, x = 2, q = 1, g = 1, saved = 2;
+            for(uint64_t r = 1; g == 1; r <<= 1){
+                x = y;
+                for(uint64_t i = 0; i < r; i++) y = f(y);
+                for(uint64_t k = 0; k < r && g == 1; k += 128){
+                    saved = y;
+                    for(uint64_t i = 0; i < std::min<uint64_t>(128, r - k); i++){
+                        y = f(y);
+                        q = MulMod(q, x > y ? x - y : y - x, n);
+                    }
+                    g = std::gcd(q, n);
+                }
+            }
+            if(g == n){
+                // The batch overshot; redo it one step at a time.
+                do{
+                    saved = f(saved);
+                    g = std::gcd(x > saved ? x - saved : saved - x, n);
+                } while(g == 1);
+            }
+            if(g != n) return g;
+        }
+    }
+
+} // namespace internal
+
+inline bool IsPrime(uint64_t n){
+    if(n < kSieveLimit) return internal::GetSieve().IsPrime(n);
+    for(uint64_t p : {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37}){
+        if(n % p == 0) return false;
+    }
+    uint64_t d = n - 1;
+    int s = 0;
+    while(d % 2 == 0){
+        d /= 2;
+        s++;
+    }
+    if(n < (uint64_t{1} << 32)){
+        for(uint64_t a : {2, 7, 61}){
+            if(!internal::PassesRound(n, d, s, a)) return false;
+        }
+        return true;
+    }
+    for(uint64_t a : {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37}){
+        if(!internal::PassesRound(n, d, s, a)) return false;
+    }
+    return true;
+}
+
+// Prime factors with multiplicities, smallest prime first. Factorize(1) is
+// empty.
+typedef std::vector<std::pair<uint64_t, int>> Factorization;
+
+inline Factorization Factorize(uint64_t n){
+    // Bounded so that a long run over distinct numbers can't eat memory.
+    static thread_local std::unordered_map<uint64_t, Factorization> cache;
+    auto it = cache.find(n);
+    if(it != cache.end()) return it->second;
+
+    const uint64_t original = n;
+    std::vector<uint64_t> primes;
+    for(uint32_t p : internal::GetSieve().primes){
+        if(uint64_t{p} * p > n) break;
+        while(n % p == 0){
+            primes.push_back(p);
+            n /= p;
+        }
+    }
+    // What's left has no factor below kSieveLimit, so it's 1, a prime, or a
+    // product of big primes.
+    std::vector<uint64_t> pending;
+    if(n > 1) pending.push_back(n);
+    while(!pending.empty()){
+        uint64_t m = pending.back();
+        pending.pop_back();
+        if(IsPrime(m)){
+            primes.push_back(m);
+            continue;
+        }
+        uint64_t f = internal::FindFactor(m);
+        pending.push_back(f);
+        pending.push_back(m / f);
+    }
+    std::sort(primes.begin(), primes.end());
+
+    Factorization result;
+    for(uint64_t p : primes){
+        if(!result.empty() && result.back().first == p) result.back().second++;
+        else result.emplace_back(p, 1);
+    }
+    if(cache.size() >= (1 << 16)) cache.clear();
+    cache.emplace(original, result);
+    return result;
+}
+
+// The largest power of the prime p dividing n: the order of a Sylow
+// p-subgroup of a group of order n.
+inline uint64_t SylowOrder(uint64_t n, uint64_t p){
+    for(const auto& [q, e] : Factorize(n)){
+        if(q != p) continue;
+        uint64_t power = 1;
+        for(int i = 0; i < e; i++) power *= p;
+        return power;
+    }
+    return 1;
+}
+
+} // namespace primality
+
+#endif